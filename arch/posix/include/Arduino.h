@@ -0,0 +1,16 @@
+#pragma once
+
+// Minimal Arduino core, for host (POSIX_PLATFORM) builds only. Just what the storage helpers need.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <Stream.h>
+
+inline unsigned long millis() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long) (ts.tv_sec * 1000UL + ts.tv_nsec / 1000000UL);
+}
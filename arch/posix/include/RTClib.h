@@ -0,0 +1,21 @@
+#pragma once
+
+// Minimal RTClib DateTime, for host (POSIX_PLATFORM) builds only
+
+#include <stdint.h>
+#include <time.h>
+
+class DateTime {
+  struct tm _tm;
+public:
+  DateTime(uint32_t t = 0) {
+    time_t tt = t;
+    gmtime_r(&tt, &_tm);
+  }
+  uint16_t year() const { return _tm.tm_year + 1900; }
+  uint8_t month() const { return _tm.tm_mon + 1; }
+  uint8_t day() const { return _tm.tm_mday; }
+  uint8_t hour() const { return _tm.tm_hour; }
+  uint8_t minute() const { return _tm.tm_min; }
+  uint8_t second() const { return _tm.tm_sec; }
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+// Minimal Arduino Print/Stream, for host (POSIX_PLATFORM) builds only
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+class Print {
+public:
+  virtual ~Print() { }
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buf, size_t len) {
+    size_t n = 0;
+    while (n < len && write(buf[n])) n++;
+    return n;
+  }
+
+  size_t print(const char* s) { return write((const uint8_t*) s, strlen(s)); }
+  size_t print(char c) { return write((uint8_t) c); }
+  size_t println(const char* s) { return print(s) + println(); }
+  size_t println() { return print("\r\n"); }
+
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+    char buf[256];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    if (n < 0) return 0;
+    return write((const uint8_t*) buf, (size_t) n < sizeof(buf) ? n : sizeof(buf) - 1);
+  }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual void flush() { }
+};
+
+/**
+ * \brief  Stream over a stdio FILE, eg. stdout to stand in for Serial
+ */
+class StdioStream : public Stream {
+  FILE* _fp;
+public:
+  StdioStream(FILE* fp) : _fp(fp) { }
+  size_t write(uint8_t c) override { return fputc(c, _fp) == EOF ? 0 : 1; }
+  size_t write(const uint8_t* buf, size_t len) override { return fwrite(buf, 1, len, _fp); }
+  int available() override { return 0; }
+  int read() override { return fgetc(_fp); }
+  int peek() override { int c = fgetc(_fp); if (c != EOF) ungetc(c, _fp); return c; }
+  void flush() override { fflush(_fp); }
+};
@@ -0,0 +1,110 @@
+// Host benchmark: linear contact scans over the full ContactInfo records (as before the contact index),
+// versus over the packed in-RAM ContactIndexEntry array that BaseChatMesh now scans.
+//
+//   g++ -O2 -std=c++17 -DPOSIX_PLATFORM -Iarch/posix/include -Isrc -Ilib/ed25519 -o contact_scan_bench bin/contact_scan_bench/contact_scan_bench.cpp
+//   ./contact_scan_bench [num_contacts] [iterations]
+//
+// NOTE: run from the repo root. Uses the real ContactInfo and ContactIndexEntry layouts, but nothing is linked
+//       from src/, so the records are never constructed (mesh::Identity's ctor is in Identity.cpp).
+#include <helpers/BaseChatMesh.h>
+#include <chrono>
+#include <random>
+
+static_assert(sizeof(ContactIndexEntry) == 32, "ContactIndexEntry should pack to 32 bytes");
+
+static volatile long sink;
+
+template <typename F>
+static double timeNanosPerScan(F scan, int iterations) {
+  auto start = std::chrono::steady_clock::now();
+  long total = 0;
+  for (int i = 0; i < iterations; i++) total += scan(i);
+  auto end = std::chrono::steady_clock::now();
+  sink = total;
+  return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+int main(int argc, char* argv[]) {
+  int n = argc > 1 ? atoi(argv[1]) : 350;
+  int iterations = argc > 2 ? atoi(argv[2]) : 200000;
+
+  std::mt19937 rng(1);
+  ContactInfo* contacts = (ContactInfo*) calloc(n, sizeof(ContactInfo));
+  ContactIndexEntry* index = (ContactIndexEntry*) calloc(n, sizeof(ContactIndexEntry));
+  for (int i = 0; i < n; i++) {
+    auto& c = contacts[i];
+    for (int j = 0; j < PUB_KEY_SIZE; j++) c.id.pub_key[j] = rng();
+    snprintf(c.name, sizeof(c.name), "contact %d", i);
+    c.lastmod = rng() % 100000;
+    c.last_advert_timestamp = rng();
+
+    auto& e = index[i];
+    memcpy(e.pub_key, c.id.pub_key, CONTACT_KEY_PREFIX_SIZE);
+    e.lastmod = c.lastmod;
+    e.last_advert_timestamp = c.last_advert_timestamp;
+    e.cache_idx = -1;
+    e.rec_id = i;
+    memcpy(e.name_key, c.name, CONTACT_NAME_KEY_SIZE);
+  }
+
+  // lookups by pub_key prefix, for keys spread over the table (plus some misses)
+  std::vector<uint8_t> keys(1024 * CONTACT_KEY_PREFIX_SIZE);
+  for (int i = 0; i < 1024; i++) {
+    if (i % 8 == 0) {
+      for (int j = 0; j < CONTACT_KEY_PREFIX_SIZE; j++) keys[i * CONTACT_KEY_PREFIX_SIZE + j] = rng();
+    } else {
+      memcpy(&keys[i * CONTACT_KEY_PREFIX_SIZE], contacts[rng() % n].id.pub_key, CONTACT_KEY_PREFIX_SIZE);
+    }
+  }
+
+  auto lookupFull = [&](int it) {
+    const uint8_t* key = &keys[(it & 1023) * CONTACT_KEY_PREFIX_SIZE];
+    for (int i = 0; i < n; i++) {
+      if (memcmp(contacts[i].id.pub_key, key, CONTACT_KEY_PREFIX_SIZE) == 0) return i;
+    }
+    return -1;
+  };
+  auto lookupIndex = [&](int it) {
+    const uint8_t* key = &keys[(it & 1023) * CONTACT_KEY_PREFIX_SIZE];
+    for (int i = 0; i < n; i++) {
+      if (memcmp(index[i].pub_key, key, CONTACT_KEY_PREFIX_SIZE) == 0) return i;
+    }
+    return -1;
+  };
+  auto hashFull = [&](int it) {   // searchPeersByHash(): all matches of 1 byte hash
+    int count = 0;
+    for (int i = 0; i < n; i++) count += contacts[i].id.pub_key[0] == (uint8_t) it;
+    return count;
+  };
+  auto hashIndex = [&](int it) {
+    int count = 0;
+    for (int i = 0; i < n; i++) count += index[i].pub_key[0] == (uint8_t) it;
+    return count;
+  };
+  auto sinceFull = [&](int it) {   // 'get contacts since' filter
+    uint32_t since = 90000 + (it & 1023);
+    int count = 0;
+    for (int i = 0; i < n; i++) count += contacts[i].lastmod > since;
+    return count;
+  };
+  auto sinceIndex = [&](int it) {
+    uint32_t since = 90000 + (it & 1023);
+    int count = 0;
+    for (int i = 0; i < n; i++) count += index[i].lastmod > since;
+    return count;
+  };
+
+  printf("%d contacts, ContactInfo %zu bytes, ContactIndexEntry %zu bytes\n", n, sizeof(ContactInfo), sizeof(ContactIndexEntry));
+  printf("%-22s %12s %12s %8s\n", "scan", "full ns", "index ns", "speed-up");
+  struct { const char* name; double full, idx; } rows[] = {
+    { "lookup by key prefix", timeNanosPerScan(lookupFull, iterations), timeNanosPerScan(lookupIndex, iterations) },
+    { "match path hash", timeNanosPerScan(hashFull, iterations), timeNanosPerScan(hashIndex, iterations) },
+    { "modified since", timeNanosPerScan(sinceFull, iterations), timeNanosPerScan(sinceIndex, iterations) },
+  };
+  for (auto& r : rows) {
+    printf("%-22s %12.1f %12.1f %7.1fx\n", r.name, r.full, r.idx, r.full / r.idx);
+  }
+  free(contacts);
+  free(index);
+  return 0;
+}
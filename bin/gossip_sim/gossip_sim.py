@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+# Flood reachability vs airtime, for gossip forwarding in a dense cluster of repeaters (see GossipPolicy).
+#
+# Scenario: a 'downtown' cluster of repeaters all in range of each other (the gossip enabled region),
+# surrounded by sparse 'suburban' repeaters which always flood. Each run sends one flood from a random
+# repeater. Units are one packet airtime. A packet is lost at a receiver if another transmission it can
+# hear overlaps it (no capture effect). Reach is counted against the nodes connected to the source.
+import argparse
+import heapq
+import math
+import random
+import statistics
+
+TX_DELAY_FACTOR = 0.5       # repeater pref default
+REF_NEIGHBOURS = 4          # TX_WINDOW_REF_NEIGHBOURS, GOSSIP_REF_NEIGHBOURS
+SNR_REF = 5.0               # GOSSIP_SNR_REF
+
+
+def make_topology(seed, args):
+    r = random.Random(seed)
+    pts = [(r.uniform(0, args.cluster_size), r.uniform(0, args.cluster_size)) for _ in range(args.cluster)]
+    mid = args.cluster_size / 2
+    for _ in range(args.suburban):
+        a = r.uniform(0, 2 * math.pi)
+        d = r.uniform(args.suburban_min, args.suburban_max)
+        pts.append((mid + d * math.cos(a), mid + d * math.sin(a)))
+    nb = [[j for j in range(len(pts)) if j != i and math.dist(pts[i], pts[j]) <= args.range] for i in range(len(pts))]
+    return pts, nb
+
+
+def link_snr(pts, i, j, args):
+    return 12 - 20 * math.dist(pts[i], pts[j]) / args.range   # dB, crude: +12 close by, -8 at edge of range
+
+
+def contention_window(num_neighbours):
+    # ContentionWindow scale, assuming ~50% duplicates
+    scale = min(3.0, max(0.1, (num_neighbours + 1) / (REF_NEIGHBOURS + 1)))
+    return 5 * TX_DELAY_FACTOR * scale
+
+
+def gossip_forward(r, path_len, snr, num_neighbours, p, k):
+    # mirrors GossipPolicy::shouldForward()
+    if path_len < k or p >= 1.0:
+        return True
+    if num_neighbours > REF_NEIGHBOURS:
+        p *= (REF_NEIGHBOURS + 1) / (num_neighbours + 1)
+    p *= min(1.5, max(0.5, 1 + (SNR_REF - snr) / 20))
+    return r.random() < p
+
+
+def run_flood(pts, nb, gossip, p, k, dups, args, seed):
+    r = random.Random(seed)
+    n = len(pts)
+    src = r.randrange(n)
+    got = [False] * n
+    got[src] = True
+    path_len = [0] * n      # of packet, as received by node
+    num_dups = [0] * n
+    cancelled = [False] * n
+    heard = {}              # receiver -> start times of transmissions it can hear
+    events = [(0.0, 0, 'tx', src)]
+    seq = 1
+    txs = cluster_txs = 0
+
+    while events:
+        t, _, kind, x = heapq.heappop(events)
+        if kind == 'tx':
+            if cancelled[x]:
+                continue
+            txs += 1
+            cluster_txs += x < args.cluster
+            for j in nb[x]:
+                heapq.heappush(events, (t + 1.0, seq, 'rx', (j, x, t)))
+                seq += 1
+                heard.setdefault(j, []).append(t)
+            continue
+
+        j, frm, start = x
+        if sum(1 for s in heard[j] if abs(s - start) < 1.0) > 1:
+            continue   # collision
+        if got[j]:
+            num_dups[j] += 1
+            if gossip and dups and j < args.cluster and num_dups[j] >= dups:
+                cancelled[j] = True   # heard enough others forward it, while still queued
+            continue
+        got[j] = True
+        path_len[j] = 0 if frm == src else path_len[frm] + 1
+
+        fwd = True
+        if gossip and j < args.cluster:
+            fwd = gossip_forward(r, path_len[j], link_snr(pts, frm, j, args), len(nb[j]), p, k)
+        if fwd:
+            heapq.heappush(events, (t + r.uniform(0, contention_window(len(nb[j]))), seq, 'tx', j))
+            seq += 1
+
+    connected = {src}
+    stack = [src]
+    while stack:
+        a = stack.pop()
+        for b in nb[a]:
+            if b not in connected:
+                connected.add(b)
+                stack.append(b)
+    return sum(got) / len(connected), txs, cluster_txs
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Simulate flood reach vs transmissions, with gossip forwarding in a dense cluster.')
+    parser.add_argument('--runs', type=int, default=1000, help='floods per setting')
+    parser.add_argument('--topologies', type=int, default=100, help='random topologies, cycled through')
+    parser.add_argument('--cluster', type=int, default=12, help='repeaters in dense cluster')
+    parser.add_argument('--cluster-size', type=float, default=0.8, help='side of cluster square')
+    parser.add_argument('--suburban', type=int, default=28, help='sparse repeaters around cluster')
+    parser.add_argument('--suburban-min', type=float, default=1.0)
+    parser.add_argument('--suburban-max', type=float, default=3.5)
+    parser.add_argument('--range', type=float, default=1.3, help='radio range')
+    parser.add_argument('--gossip', action='append', metavar='P,K,DUPS',
+                        help='gossip setting to compare (as "set gossip"), may be repeated')
+    args = parser.parse_args()
+
+    settings = [('full flood', False, 1.0, 0, 0)]
+    for g in args.gossip or ['65,2,0', '65,2,2', '50,2,2', '65,1,2']:
+        p, k, dups = (int(v) for v in g.split(','))
+        settings.append(('gossip %d,%d,%d' % (p, k, dups), True, p / 100.0, k, dups))
+
+    for name, gossip, p, k, dups in settings:
+        reach, txs, cluster_txs = [], [], []
+        for s in range(args.runs):
+            pts, nb = make_topology(s % args.topologies, args)
+            a, b, c = run_flood(pts, nb, gossip, p, k, dups, args, s)
+            reach.append(a)
+            txs.append(b)
+            cluster_txs.append(c)
+        print('%-18s reach %5.1f%%  tx/flood %5.1f  (cluster %4.1f of %d)' % (name, statistics.mean(reach) * 100,
+              statistics.mean(txs), statistics.mean(cluster_txs), args.cluster))
+
+
+if __name__ == '__main__':
+    main()
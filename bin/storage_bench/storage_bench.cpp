@@ -0,0 +1,115 @@
+// Host benchmark: flash wear and latency of packet logging, through PosixFS with the NOR flash model.
+// Compares the old per-packet text append (open, print a line, close) with helpers/PacketLog, which
+// buffers compact binary records in RAM and appends them in batches.
+//
+//   g++ -O2 -std=c++17 -DPOSIX_PLATFORM -Iarch/posix/include -Isrc -o storage_bench bin/storage_bench/storage_bench.cpp src/helpers/PacketLog.cpp src/helpers/posix/PosixFileSystem.cpp
+//   ./storage_bench [num_packets] [interval_millis]
+//
+// NOTE: run from the repo root. Scratch files go in a temp dir, which is removed afterwards.
+//       arch/posix/include has just enough of the Arduino core (and RTClib) for the storage helpers.
+#include <Arduino.h>
+#include <helpers/PacketLog.h>
+#include <RTClib.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define LOG_FILE  "/pkt_log"
+
+static void makeTestPacket(mesh::Packet& pkt, uint32_t n) {
+  static const uint8_t types[] = { PAYLOAD_TYPE_ADVERT, PAYLOAD_TYPE_TXT_MSG, PAYLOAD_TYPE_REQ, PAYLOAD_TYPE_ACK,
+                                   PAYLOAD_TYPE_PATH, PAYLOAD_TYPE_GRP_TXT };
+  memset((void*) &pkt, 0, sizeof(pkt));
+  pkt.header = (types[n % sizeof(types)] << PH_TYPE_SHIFT) | (n & 1 ? ROUTE_TYPE_FLOOD : ROUTE_TYPE_DIRECT);
+  pkt.payload_len = 20 + (n * 37) % 120;
+  pkt.payload[0] = n * 13;
+  pkt.payload[1] = n * 7;
+}
+
+// as simple_repeater's logRx() did, before PacketLog
+static void legacyLogRx(PosixFS& fs, uint32_t timestamp, const mesh::Packet& pkt, int len, float score) {
+  File f = fs.open(LOG_FILE, "a", true);
+  if (f) {
+    DateTime dt(timestamp);
+    f.printf("%02d:%02d:%02d - %d/%d/%d U", dt.hour(), dt.minute(), dt.second(), dt.day(), dt.month(), dt.year());
+    f.printf(": RX, len=%d (type=%d, route=%s, payload_len=%d) SNR=%d RSSI=%d score=%d", len,
+             pkt.getPayloadType(), pkt.isRouteDirect() ? "D" : "F", pkt.payload_len, 8, -95, (int)(score * 1000));
+
+    uint8_t t = pkt.getPayloadType();
+    if (t == PAYLOAD_TYPE_PATH || t == PAYLOAD_TYPE_REQ || t == PAYLOAD_TYPE_RESPONSE || t == PAYLOAD_TYPE_TXT_MSG) {
+      f.printf(" [%02X -> %02X]\n", (uint32_t)pkt.payload[1], (uint32_t)pkt.payload[0]);
+    } else {
+      f.printf("\n");
+    }
+    f.close();
+  }
+}
+
+class LineCounter : public Stream {
+public:
+  uint32_t lines = 0;
+  size_t write(uint8_t c) override { if (c == '\n') lines++; return 1; }
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+};
+
+static void printStats(const char* label, const posixfs::FlashStats& s, uint32_t num_packets) {
+  printf("%-22s %10llu %8u %8u %8u %10.1f %10.2f\n", label, (unsigned long long) s.bytes_written,
+         s.page_programs, s.block_erases, s.max_block_erases, s.simulated_us / 1000.0,
+         s.simulated_us / 1000.0 / num_packets);
+}
+
+int main(int argc, char* argv[]) {
+  uint32_t num_packets = argc > 1 ? atoi(argv[1]) : 5000;
+  unsigned long interval = argc > 2 ? atoi(argv[2]) : 2000;   // between packets, in (simulated) millis
+
+  char root[] = "/tmp/storage_bench.XXXXXX";
+  if (mkdtemp(root) == NULL) { perror("mkdtemp"); return 1; }
+
+  posixfs::FlashModelConfig cfg;   // nRF52840 internal flash
+  uint32_t base_time = 1700000000;
+  alignas(mesh::Packet) static uint8_t pkt_mem[sizeof(mesh::Packet)];
+  mesh::Packet& pkt = *(mesh::Packet*) pkt_mem;   // NOTE: not constructed, Packet.cpp needs the Crypto lib
+
+  printf("%u packets, one every %lu ms, %u byte pages, %u byte erase blocks\n\n", num_packets, interval,
+         cfg.page_size, cfg.block_size);
+  printf("%-22s %10s %8s %8s %8s %10s %10s\n", "", "bytes", "programs", "erases", "max/blk", "flash ms", "ms/pkt");
+
+  // old: one text line appended per packet
+  std::string dir = std::string(root) + "/legacy";
+  PosixFS legacy_fs(dir.c_str());
+  legacy_fs.enableFlashModel(cfg);
+  for (uint32_t i = 0; i < num_packets; i++) {
+    makeTestPacket(pkt, i);
+    legacyLogRx(legacy_fs, base_time + i * interval / 1000, pkt, pkt.payload_len + 2, 0.8f);
+  }
+  printStats("text, per packet", legacy_fs.getFlashStats(), num_packets);
+
+  // new: PacketLog, flushed from loop() at its watermark, or when records have aged
+  dir = std::string(root) + "/packet_log";
+  PosixFS fs(dir.c_str());
+  fs.enableFlashModel(cfg);
+  PacketLog log(LOG_FILE);
+  log.begin(&fs);
+  unsigned long now = 0;
+  for (uint32_t i = 0; i < num_packets; i++, now += interval) {
+    makeTestPacket(pkt, i);
+    log.add(PKT_LOG_RX, base_time + now / 1000, now, &pkt, pkt.payload_len + 2, 8, -95, 0.8f);
+    log.loop(now);
+  }
+  log.flush();
+  printStats("PacketLog, batched", fs.getFlashStats(), num_packets);
+
+  // check nothing was lost
+  LineCounter counter;
+  fs.disableFlashModel();
+  log.dump(counter);
+  printf("\nPacketLog: %u records dumped, %u dropped\n", counter.lines, log.getNumDropped());
+
+  legacy_fs.format();
+  fs.format();
+  rmdir((std::string(root) + "/legacy").c_str());
+  rmdir((std::string(root) + "/packet_log").c_str());
+  rmdir(root);
+  return counter.lines == num_packets ? 0 : 1;
+}
@@ -1,11 +1,6 @@
 #include <Arduino.h>
 #include "DataStore.h"
-
-#if defined(EXTRAFS) || defined(QSPIFLASH)
-  #define MAX_BLOBRECS 100
-#else
-  #define MAX_BLOBRECS 20
-#endif
+#include <helpers/RecordHelpers.h>
 
 DataStore::DataStore(FILESYSTEM& fs, mesh::RTCClock& clock) : _fs(&fs), _fsExtra(nullptr), _clock(&clock),
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
@@ -16,6 +11,9 @@ DataStore::DataStore(FILESYSTEM& fs, mesh::RTCClock& clock) : _fs(&fs), _fsExtra
     identity_store(fs, "/identity")
 #endif
 {
+  memset(_contact_loc, 0xFF, sizeof(_contact_loc));
+  _journal_len = 0;
+  _compact_due = _compacting = false;
 }
 
 #if defined(EXTRAFS) || defined(QSPIFLASH)
@@ -28,6 +26,9 @@ DataStore::DataStore(FILESYSTEM& fs, FILESYSTEM& fsExtra, mesh::RTCClock& clock)
     identity_store(fs, "/identity")
 #endif
 {
+  memset(_contact_loc, 0xFF, sizeof(_contact_loc));
+  _journal_len = 0;
+  _compact_due = _compacting = false;
 }
 #endif
 
@@ -57,6 +58,7 @@ void DataStore::begin() {
   #if defined(EXTRAFS) || defined(QSPIFLASH)
   migrateToSecondaryFS();
   #endif
+  loadBlobIndex();
 #else
   // init 'blob store' support
   _fs->mkdir("/bl");
@@ -164,6 +166,7 @@ bool DataStore::removeFile(FILESYSTEM* fs, const char* filename) {
 }
 
 bool DataStore::formatFileSystem() {
+  _compacting = false;   // files it was working on are about to go
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
   if (_fsExtra == nullptr) {
     return _fs->format();
@@ -268,64 +271,327 @@ void DataStore::savePrefs(const NodePrefs& _prefs, double node_lat, double node_
   }
 }
 
+/*
+ * Contacts are persisted as a base file, /contacts3 (fixed 152 byte records, indexed by rec_id), plus an
+ * append-only journal, /contacts3j, of upsert/delete records. Each update just appends one journal record,
+ * and compactContacts() folds the journal back into the base file once it grows past CONTACTS_JOURNAL_MAX_RECS.
+ * From loop(), compactContactsStep() does that a few records per call, while updates keep being journalled.
+ */
+#define CONTACT_REC_SIZE   152   // size of each record in /contacts3
+#define JOURNAL_REC_SIZE   (4 + CONTACT_REC_SIZE + 4)   // op(1), reserved(1), rec_id(2), contact, checksum(4)
+
+#define JOURNAL_OP_UPSERT   1
+#define JOURNAL_OP_DELETE   2
+
+#define LOC_NONE       0xFFFFFFFF
+#define LOC_JOURNAL    0x80000000   // offset is in /contacts3j, otherwise in /contacts3
+
+#ifndef CONTACTS_JOURNAL_MAX_RECS
+  #define CONTACTS_JOURNAL_MAX_RECS   32
+#endif
+
+static uint8_t io_block[8 * JOURNAL_REC_SIZE];   // for reading several records per file read
+
+static void packContactRec(uint8_t* dest, const ContactInfo& c) {
+  memset(dest, 0, CONTACT_REC_SIZE);
+  memcpy(&dest[0], c.id.pub_key, 32);
+  memcpy(&dest[32], c.name, 32);
+  dest[64] = c.type;
+  dest[65] = c.flags;
+  // [66] unused
+  writeLE32(&dest[67], c.sync_since);   // was 'reserved'
+  dest[71] = (uint8_t) c.out_path_len;
+  writeLE32(&dest[72], c.last_advert_timestamp);
+  memcpy(&dest[76], c.out_path, 64);
+  writeLE32(&dest[140], c.lastmod);
+  writeLE32(&dest[144], (uint32_t) c.gps_lat);
+  writeLE32(&dest[148], (uint32_t) c.gps_lon);
+}
+
+static void unpackContactRec(ContactInfo& c, const uint8_t* src) {
+  memset(&c, 0, sizeof(c));
+  c.id = mesh::Identity(&src[0]);
+  memcpy(c.name, &src[32], 32);
+  c.type = src[64];
+  c.flags = src[65];
+  c.sync_since = readLE32(&src[67]);
+  c.out_path_len = (int8_t) src[71];
+  c.last_advert_timestamp = readLE32(&src[72]);
+  memcpy(c.out_path, &src[76], 64);
+  c.lastmod = readLE32(&src[140]);
+  c.gps_lat = (int32_t) readLE32(&src[144]);
+  c.gps_lon = (int32_t) readLE32(&src[148]);
+}
+
+static bool isEmptyRec(const uint8_t* rec) {   // deleted records are all zeroes
+  for (int i = 0; i < PUB_KEY_SIZE; i++) {
+    if (rec[i]) return false;
+  }
+  return true;
+}
+
+static uint32_t calcChecksum(const uint8_t* data, int len) {   // FNV-1a
+  uint32_t h = 2166136261u;
+  while (len-- > 0) { h ^= *data++; h *= 16777619u; }
+  return h;
+}
+
+static File openAppend(FILESYSTEM* fs, const char* filename) {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  return fs->open(filename, FILE_O_WRITE);   // NOTE: positions at end of file
+#else
+  return fs->open(filename, "a");
+#endif
+}
+
+static bool readRecAt(File& file, uint32_t loc, uint8_t* dest) {
+  uint32_t pos = (loc & LOC_JOURNAL) ? (loc & ~LOC_JOURNAL) + 4 : loc;
+  return file && file.seek(pos) && file.read(dest, CONTACT_REC_SIZE) == CONTACT_REC_SIZE;
+}
+
 void DataStore::loadContacts(DataStoreHost* host) {
-File file = openRead(_getContactsChannelsFS(), "/contacts3");
-    if (file) {
-      bool full = false;
-      while (!full) {
-        ContactInfo c;
-        uint8_t pub_key[32];
-        uint8_t unused;
-
-        bool success = (file.read(pub_key, 32) == 32);
-        success = success && (file.read((uint8_t *)&c.name, 32) == 32);
-        success = success && (file.read(&c.type, 1) == 1);
-        success = success && (file.read(&c.flags, 1) == 1);
-        success = success && (file.read(&unused, 1) == 1);
-        success = success && (file.read((uint8_t *)&c.sync_since, 4) == 4); // was 'reserved'
-        success = success && (file.read((uint8_t *)&c.out_path_len, 1) == 1);
-        success = success && (file.read((uint8_t *)&c.last_advert_timestamp, 4) == 4);
-        success = success && (file.read(c.out_path, 64) == 64);
-        success = success && (file.read((uint8_t *)&c.lastmod, 4) == 4);
-        success = success && (file.read((uint8_t *)&c.gps_lat, 4) == 4);
-        success = success && (file.read((uint8_t *)&c.gps_lon, 4) == 4);
+  FILESYSTEM* fs = _getContactsChannelsFS();
+  if (!fs->exists("/contacts3") && fs->exists("/contacts3.new")) {   // compaction was interrupted
+    fs->rename("/contacts3.new", "/contacts3");
+  }
+  if (!fs->exists("/contacts3j") && fs->exists("/contacts3j.new")) {   // ... just before restoring journal tail
+    fs->rename("/contacts3j.new", "/contacts3j");
+  }
+  memset(_contact_loc, 0xFF, sizeof(_contact_loc));  // all LOC_NONE
+  _journal_len = 0;
+  _compact_due = _compacting = false;
 
-        if (!success) break; // EOF
+  const uint8_t* rec;
+  uint32_t file_len = 0;
+  File file = openRead(fs, "/contacts3");
+  if (file) {
+    BlockRecordReader rd(file, io_block, sizeof(io_block), CONTACT_REC_SIZE);
+    while ((rec = rd.next()) != NULL) {
+      uint32_t rec_id = rd.lastPos() / CONTACT_REC_SIZE;
+      if (rec_id < MAX_CONTACTS && !isEmptyRec(rec)) {
+        _contact_loc[rec_id] = rd.lastPos();
+      }
+      file_len = rd.lastPos() + CONTACT_REC_SIZE;
+    }
+    file.close();
+  }
 
-        c.id = mesh::Identity(pub_key);
-        if (!host->onContactLoaded(c)) full = true;
+  // replay the journal
+  File journal = openRead(fs, "/contacts3j");
+  if (journal) {
+    BlockRecordReader rd(journal, io_block, sizeof(io_block), JOURNAL_REC_SIZE);
+    while ((rec = rd.next()) != NULL) {
+      uint16_t rec_id = readLE16(&rec[2]);
+      if (readLE32(&rec[JOURNAL_REC_SIZE - 4]) != calcChecksum(rec, JOURNAL_REC_SIZE - 4) || rec_id >= MAX_CONTACTS) break;  // eg. torn write
+
+      _contact_loc[rec_id] = rec[0] == JOURNAL_OP_UPSERT ? (LOC_JOURNAL | rd.lastPos()) : LOC_NONE;
+      _journal_len = rd.lastPos() + JOURNAL_REC_SIZE;
+    }
+    if (_journal_len < journal.size()) _compact_due = true;   // need to discard the bad tail before appending
+    journal.close();
+  }
+  if (_journal_len >= CONTACTS_JOURNAL_MAX_RECS * JOURNAL_REC_SIZE) _compact_due = true;
+
+  // re-home any records beyond MAX_CONTACTS into free slots (eg. MAX_CONTACTS has been reduced)
+  uint32_t rec_id = 0;
+  for (uint32_t pos = MAX_CONTACTS * CONTACT_REC_SIZE; pos < file_len; pos += CONTACT_REC_SIZE) {
+    while (rec_id < MAX_CONTACTS && _contact_loc[rec_id] != LOC_NONE) rec_id++;
+    if (rec_id >= MAX_CONTACTS) break;  // full
+
+    _contact_loc[rec_id] = pos;   // NOTE: empty ones are weeded out below
+    _compact_due = true;
+  }
+
+  // now pass current records to host, in file order
+  bool full = false;
+  file = openRead(fs, "/contacts3");
+  if (file) {
+    BlockRecordReader rd(file, io_block, sizeof(io_block), CONTACT_REC_SIZE);
+    while (!full && (rec = rd.next()) != NULL) {
+      uint32_t pos = rd.lastPos();
+      uint32_t id = pos / CONTACT_REC_SIZE;
+      if (id >= MAX_CONTACTS) {   // was re-homed?
+        for (id = 0; id < MAX_CONTACTS && _contact_loc[id] != pos; id++) ;
+        if (id >= MAX_CONTACTS) continue;
+        if (isEmptyRec(rec)) { _contact_loc[id] = LOC_NONE; continue; }
       }
-      file.close();
+      if (_contact_loc[id] == pos) full = !deliverContact(host, id, rec);
     }
+    file.close();
+  }
+  journal = openRead(fs, "/contacts3j");
+  if (journal) {
+    BlockRecordReader rd(journal, io_block, sizeof(io_block), JOURNAL_REC_SIZE);
+    while (!full && (rec = rd.next()) != NULL && rd.lastPos() < _journal_len) {
+      uint16_t id = readLE16(&rec[2]);
+      if (_contact_loc[id] == (LOC_JOURNAL | rd.lastPos())) full = !deliverContact(host, id, &rec[4]);
+    }
+    journal.close();
+  }
+
+  if (_compact_due) compactContacts();
 }
 
-void DataStore::saveContacts(DataStoreHost* host) {
-  File file = openWrite(_getContactsChannelsFS(), "/contacts3");
-  if (file) {
-    uint32_t idx = 0;
-    ContactInfo c;
-    uint8_t unused = 0;
-
-    while (host->getContactForSave(idx, c)) {
-      bool success = (file.write(c.id.pub_key, 32) == 32);
-      success = success && (file.write((uint8_t *)&c.name, 32) == 32);
-      success = success && (file.write(&c.type, 1) == 1);
-      success = success && (file.write(&c.flags, 1) == 1);
-      success = success && (file.write(&unused, 1) == 1);
-      success = success && (file.write((uint8_t *)&c.sync_since, 4) == 4);
-      success = success && (file.write((uint8_t *)&c.out_path_len, 1) == 1);
-      success = success && (file.write((uint8_t *)&c.last_advert_timestamp, 4) == 4);
-      success = success && (file.write(c.out_path, 64) == 64);
-      success = success && (file.write((uint8_t *)&c.lastmod, 4) == 4);
-      success = success && (file.write((uint8_t *)&c.gps_lat, 4) == 4);
-      success = success && (file.write((uint8_t *)&c.gps_lon, 4) == 4);
+bool DataStore::deliverContact(DataStoreHost* host, uint32_t rec_id, const uint8_t* rec) {
+  ContactInfo c;
+  unpackContactRec(c, rec);
+  return host->onContactLoaded(c, rec_id);
+}
 
-      if (!success) break; // write failed
+bool DataStore::readContactRecord(uint32_t rec_id, ContactInfo& dest) {
+  if (rec_id >= MAX_CONTACTS || _contact_loc[rec_id] == LOC_NONE) return false;
+
+  uint32_t loc = _contact_loc[rec_id];
+  File file = openRead(_getContactsChannelsFS(), (loc & LOC_JOURNAL) ? "/contacts3j" : "/contacts3");
+  uint8_t buf[CONTACT_REC_SIZE];
+  bool success = readRecAt(file, loc, buf);
+  if (file) file.close();
+
+  if (success) unpackContactRec(dest, buf);
+  return success;
+}
+
+bool DataStore::appendContactJournal(uint8_t op, uint32_t rec_id, const ContactInfo* src) {
+  if (rec_id >= MAX_CONTACTS) return false;
+
+  uint8_t buf[JOURNAL_REC_SIZE];
+  memset(buf, 0, sizeof(buf));
+  buf[0] = op;
+  writeLE16(&buf[2], rec_id);
+  if (src) packContactRec(&buf[4], *src);
+  writeLE32(&buf[JOURNAL_REC_SIZE - 4], calcChecksum(buf, JOURNAL_REC_SIZE - 4));
+
+  File file = openAppend(_getContactsChannelsFS(), "/contacts3j");
+  if (!file) return false;
+
+  uint32_t pos = file.size();
+  bool success = (file.write(buf, sizeof(buf)) == sizeof(buf));
+  file.close();
+  if (!success) {
+    compactContacts();   // journal may now have a partial record at the end, so rewrite everything
+    return false;
+  }
+
+  _contact_loc[rec_id] = op == JOURNAL_OP_UPSERT ? (LOC_JOURNAL | pos) : LOC_NONE;
+  _journal_len = pos + sizeof(buf);
+  if (_journal_len >= CONTACTS_JOURNAL_MAX_RECS * JOURNAL_REC_SIZE) _compact_due = true;
+  return true;
+}
 
-      idx++;  // advance to next contact
+bool DataStore::writeContactRecord(uint32_t rec_id, const ContactInfo& src) {
+  return appendContactJournal(JOURNAL_OP_UPSERT, rec_id, &src);
+}
+
+void DataStore::deleteContactRecord(uint32_t rec_id) {
+  if (rec_id < MAX_CONTACTS && _contact_loc[rec_id] != LOC_NONE) {
+    appendContactJournal(JOURNAL_OP_DELETE, rec_id, NULL);
+  }
+}
+
+bool DataStore::compactContacts() {   // all in one go
+  bool success;
+  do {
+    success = compactContactsStep();
+  } while (success && _compacting);
+  return success;
+}
+
+bool DataStore::compactContactsStep() {
+  FILESYSTEM* fs = _getContactsChannelsFS();
+  if (!_compacting) {
+    _compact_due = false;   // NOTE: if this fails, will be retried once journal grows again
+    fs->remove("/contacts3j.new");   // in case left over from a failed attempt
+    File dest = openWrite(fs, "/contacts3.new");
+    if (!dest) return false;
+    dest.close();
+
+    _compacting = true;
+    _compact_next = _compact_n = 0;
+    _compact_journal_start = _journal_len;
+  }
+
+  // copy (at most) one io_block's worth of records to dest, so radio etc still get serviced in between
+  File file = openRead(fs, "/contacts3");
+  File journal = openRead(fs, "/contacts3j");
+  bool success = true;
+  int len = 0;      // bytes pending in io_block[]
+  uint32_t rec_id = _compact_next;
+  while (success && rec_id < MAX_CONTACTS && len + CONTACT_REC_SIZE <= sizeof(io_block)) {
+    uint32_t loc = _contact_loc[rec_id];
+    if (loc == LOC_NONE) {
+      rec_id++;
+      continue;
     }
-    file.close();
+    if (_compact_n < rec_id) {
+      memset(&io_block[len], 0, CONTACT_REC_SIZE);   // fill gap with empty records
+    } else {
+      success = readRecAt((loc & LOC_JOURNAL) ? journal : file, loc, &io_block[len]);
+      rec_id++;
+    }
+    len += CONTACT_REC_SIZE;
+    _compact_n++;
+  }
+  if (file) file.close();
+  if (journal) journal.close();
+
+  if (success && len > 0) {
+    File dest = openAppend(fs, "/contacts3.new");
+    success = dest && dest.write(io_block, len) == len;
+    if (dest) dest.close();
+  }
+  _compact_next = rec_id;
+
+  if (success && rec_id >= MAX_CONTACTS) success = finishCompaction();
+  if (!success) {
+    fs->remove("/contacts3.new");
+    _compacting = false;
+    MESH_DEBUG_PRINTLN("compactContacts: failed");
   }
+  return success;
+}
+
+bool DataStore::finishCompaction() {
+  FILESYSTEM* fs = _getContactsChannelsFS();
+
+  // journal records added since compaction started may be newer than what was copied, so keep those
+  uint32_t tail = _journal_len - _compact_journal_start;
+  if (tail > 0) {
+    File journal = openRead(fs, "/contacts3j");
+    File dest = openWrite(fs, "/contacts3j.new");
+    bool success = journal && dest && journal.seek(_compact_journal_start);
+    for (uint32_t pos = 0; success && pos < tail; ) {
+      int n = tail - pos < sizeof(io_block) ? tail - pos : sizeof(io_block);
+      success = journal.read(io_block, n) == n && dest.write(io_block, n) == n;
+      pos += n;
+    }
+    if (journal) journal.close();
+    if (dest) dest.close();
+    if (!success) {
+      fs->remove("/contacts3j.new");
+      return false;
+    }
+  }
+
+  // NOTE: loadContacts() recovers from an interruption at any point here
+  fs->remove("/contacts3");
+  fs->rename("/contacts3.new", "/contacts3");
+  fs->remove("/contacts3j");
+  if (tail > 0) fs->rename("/contacts3j.new", "/contacts3j");
+
+  for (uint32_t rec_id = 0; rec_id < MAX_CONTACTS; rec_id++) {
+    uint32_t loc = _contact_loc[rec_id];
+    if (loc == LOC_NONE) continue;
+
+    if ((loc & LOC_JOURNAL) && (loc & ~LOC_JOURNAL) >= _compact_journal_start) {
+      _contact_loc[rec_id] = LOC_JOURNAL | ((loc & ~LOC_JOURNAL) - _compact_journal_start);
+    } else {
+      _contact_loc[rec_id] = rec_id * CONTACT_REC_SIZE;
+    }
+  }
+  _journal_len = tail;
+  _compact_due = _journal_len >= CONTACTS_JOURNAL_MAX_RECS * JOURNAL_REC_SIZE;   // NOTE: appends since start may have set it
+  _compacting = false;
+  return true;
 }
 
 void DataStore::loadChannels(DataStoreHost* host) {
@@ -395,7 +661,61 @@ void DataStore::checkAdvBlobFile() {
       }
       file.close();
     }
+    memset(_blob_index, 0, sizeof(_blob_index));   // all empty
+    memset(_blob_buckets, 0, sizeof(_blob_buckets));
+  }
+}
+
+void DataStore::loadBlobIndex() {
+  memset(_blob_index, 0, sizeof(_blob_index));
+  memset(_blob_buckets, 0, sizeof(_blob_buckets));
+
+  File file = _getContactsChannelsFS()->open("/adv_blobs", FILE_O_WRITE);   // NOTE: positioned at end
+  if (file) {
+    BlobRec tmp;
+    memset(&tmp, 0, sizeof(tmp));
+    for (uint32_t n = file.size() / sizeof(tmp); n < MAX_BLOBRECS; n++) {   // eg. MAX_BLOBRECS has been increased
+      file.write((uint8_t *) &tmp, sizeof(tmp));
+    }
+
+    for (int i = 0; i < MAX_BLOBRECS; i++) {   // just need the header of each record
+      file.seek(i * sizeof(tmp));
+      if (file.read((uint8_t *) &tmp, sizeof(tmp.timestamp) + sizeof(tmp.key)) != sizeof(tmp.timestamp) + sizeof(tmp.key)) break;
+
+      _blob_index[i].timestamp = tmp.timestamp;
+      memcpy(_blob_index[i].key, tmp.key, sizeof(tmp.key));
+      if (tmp.timestamp) linkBlobSlot(i);
+    }
+    file.close();
+  }
+}
+
+void DataStore::linkBlobSlot(int slot) {
+  uint8_t* head = &_blob_buckets[_blob_index[slot].key[0] & (BLOB_HASH_BUCKETS - 1)];
+  _blob_index[slot].next = *head;
+  *head = slot + 1;
+}
+
+void DataStore::unlinkBlobSlot(int slot) {
+  uint8_t* link = &_blob_buckets[_blob_index[slot].key[0] & (BLOB_HASH_BUCKETS - 1)];
+  while (*link) {
+    if (*link == slot + 1) {
+      *link = _blob_index[slot].next;
+      break;
+    }
+    link = &_blob_index[*link - 1].next;
+  }
+  _blob_index[slot].next = 0;
+}
+
+int DataStore::findBlobSlot(const uint8_t key[]) const {
+  uint8_t i = _blob_buckets[key[0] & (BLOB_HASH_BUCKETS - 1)];
+  while (i) {
+    auto e = &_blob_index[i - 1];
+    if (memcmp(key, e->key, sizeof(e->key)) == 0) return i - 1;  // only match by 7 byte prefix
+    i = e->next;
   }
+  return -1;  // not found
 }
 
 void DataStore::migrateToSecondaryFS() {
@@ -409,8 +729,8 @@ void DataStore::migrateToSecondaryFS() {
       BlobRec rec;
       size_t count = 0;
 
-      // Copy 20 BlobRecs from old to new
-      while (count < 20 && oldAdvBlobs.read((uint8_t *)&rec, sizeof(rec)) == sizeof(rec)) {
+      // Copy BlobRecs from old to new
+      while (count < MAX_BLOBRECS && oldAdvBlobs.read((uint8_t *)&rec, sizeof(rec)) == sizeof(rec)) {
         newAdvBlobs.seek(count * sizeof(BlobRec));
         newAdvBlobs.write((uint8_t *)&rec, sizeof(rec));
         count++;
@@ -507,16 +827,17 @@ void DataStore::migrateToSecondaryFS() {
 }
 
 uint8_t DataStore::getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_buf[]) {
+  int slot = findBlobSlot(key);
+  if (slot < 0) return 0;  // not found
+
   File file = openRead(_getContactsChannelsFS(), "/adv_blobs");
-  uint8_t len = 0;  // 0 = not found
+  uint8_t len = 0;
   if (file) {
     BlobRec tmp;
-    while (file.read((uint8_t *) &tmp, sizeof(tmp)) == sizeof(tmp)) {
-      if (memcmp(key, tmp.key, sizeof(tmp.key)) == 0) {  // only match by 7 byte prefix
-        len = tmp.len;
-        memcpy(dest_buf, tmp.data, len);
-        break;
-      }
+    if (file.seek(slot * sizeof(tmp)) && file.read((uint8_t *) &tmp, sizeof(tmp)) == sizeof(tmp)
+        && memcmp(key, tmp.key, sizeof(tmp.key)) == 0) {
+      len = tmp.len;
+      memcpy(dest_buf, tmp.data, len);
     }
     file.close();
   }
@@ -526,37 +847,34 @@ uint8_t DataStore::getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_b
 bool DataStore::putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], uint8_t len) {
   if (len < PUB_KEY_SIZE+4+SIGNATURE_SIZE || len > MAX_ADVERT_PKT_LEN) return false;
   checkAdvBlobFile();
-  File file = _getContactsChannelsFS()->open("/adv_blobs", FILE_O_WRITE);
-  if (file) {
-    uint32_t pos = 0, found_pos = 0;
-    uint32_t min_timestamp = 0xFFFFFFFF;
-
-    // search for matching key OR evict by oldest timestmap
-    BlobRec tmp;
-    file.seek(0);
-    while (file.read((uint8_t *) &tmp, sizeof(tmp)) == sizeof(tmp)) {
-      if (memcmp(key, tmp.key, sizeof(tmp.key)) == 0) {  // only match by 7 byte prefix
-        found_pos = pos;
-        break;
-      }
-      if (tmp.timestamp < min_timestamp) {
-        min_timestamp = tmp.timestamp;
-        found_pos = pos;
-      }
 
-      pos += sizeof(tmp);
+  // search for matching key OR evict by oldest timestmap
+  int slot = findBlobSlot(key);
+  if (slot < 0) {
+    slot = 0;
+    for (int i = 1; i < MAX_BLOBRECS; i++) {
+      if (_blob_index[i].timestamp < _blob_index[slot].timestamp) slot = i;
     }
+  }
 
+  File file = _getContactsChannelsFS()->open("/adv_blobs", FILE_O_WRITE);
+  if (file) {
+    BlobRec tmp;
     memcpy(tmp.key, key, sizeof(tmp.key));  // just record 7 byte prefix of key
     memcpy(tmp.data, src_buf, len);
     tmp.len = len;
     tmp.timestamp = _clock->getCurrentTime();
 
-    file.seek(found_pos);
-    file.write((uint8_t *) &tmp, sizeof(tmp));
-
+    bool success = file.seek(slot * sizeof(tmp)) && file.write((uint8_t *) &tmp, sizeof(tmp)) == sizeof(tmp);
     file.close();
-    return true;
+
+    if (success) {
+      unlinkBlobSlot(slot);   // replacing OR evicting (OR empty)
+      _blob_index[slot].timestamp = tmp.timestamp;
+      memcpy(_blob_index[slot].key, tmp.key, sizeof(tmp.key));
+      linkBlobSlot(slot);
+    }
+    return success;
   }
   return false; // error
 }
@@ -5,10 +5,25 @@
 #include <helpers/ChannelDetails.h>
 #include "NodePrefs.h"
 
+#ifndef MAX_CONTACTS
+#define MAX_CONTACTS 100
+#endif
+
+#ifndef MAX_BLOBRECS    // number of advert blobs kept in /adv_blobs (NRF52/STM32 only)
+  #if defined(EXTRAFS) || defined(QSPIFLASH)
+    #define MAX_BLOBRECS 100
+  #else
+    #define MAX_BLOBRECS 20
+  #endif
+#endif
+#if MAX_BLOBRECS > 255
+  #error "MAX_BLOBRECS must fit in uint8_t index links"
+#endif
+#define BLOB_HASH_BUCKETS   16    // must be power of 2
+
 class DataStoreHost {
 public:
-  virtual bool onContactLoaded(const ContactInfo& contact) =0;
-  virtual bool getContactForSave(uint32_t idx, ContactInfo& contact) =0;
+  virtual bool onContactLoaded(const ContactInfo& contact, uint32_t rec_id) =0;
   virtual bool onChannelLoaded(uint8_t channel_idx, const ChannelDetails& ch) =0;
   virtual bool getChannelForSave(uint8_t channel_idx, ChannelDetails& ch) =0;
 };
@@ -18,10 +33,33 @@ class DataStore {
   FILESYSTEM* _fsExtra;
   mesh::RTCClock* _clock;
   IdentityStore identity_store;
+  uint32_t _contact_loc[MAX_CONTACTS];   // where the current record for each rec_id is (see DataStore.cpp)
+  uint32_t _journal_len;
+  bool _compact_due;
+  bool _compacting;                 // part way through compactContactsStep()s
+  uint32_t _compact_next;           // next rec_id to copy to /contacts3.new
+  uint32_t _compact_n;              // num records in /contacts3.new so far
+  uint32_t _compact_journal_start;  // journal length when compaction started
+
+  bool appendContactJournal(uint8_t op, uint32_t rec_id, const ContactInfo* src);
+  bool deliverContact(DataStoreHost* host, uint32_t rec_id, const uint8_t* rec);
+  bool finishCompaction();
 
   void loadPrefsInt(const char *filename, NodePrefs& prefs, double& node_lat, double& node_lon);
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  struct BlobIndexEntry {
+    uint32_t timestamp;   // 0 = empty record
+    uint8_t  key[7];
+    uint8_t  next;        // (slot + 1) of next in same hash bucket, 0 = end
+  };
+  BlobIndexEntry _blob_index[MAX_BLOBRECS];   // in-RAM copy of the /adv_blobs record headers
+  uint8_t _blob_buckets[BLOB_HASH_BUCKETS];   // (slot + 1) of first in bucket, by first byte of key
+
   void checkAdvBlobFile();
+  void loadBlobIndex();
+  void linkBlobSlot(int slot);
+  void unlinkBlobSlot(int slot);
+  int  findBlobSlot(const uint8_t key[]) const;
 #endif
 
 public:
@@ -36,7 +74,12 @@ public:
   void loadPrefs(NodePrefs& prefs, double& node_lat, double& node_lon);
   void savePrefs(const NodePrefs& prefs, double node_lat, double node_lon);
   void loadContacts(DataStoreHost* host);
-  void saveContacts(DataStoreHost* host);
+  bool readContactRecord(uint32_t rec_id, ContactInfo& dest);
+  bool writeContactRecord(uint32_t rec_id, const ContactInfo& src);
+  void deleteContactRecord(uint32_t rec_id);
+  bool isContactsCompactionDue() const { return _compact_due || _compacting; }
+  bool compactContacts();
+  bool compactContactsStep();   // copies a few records per call, from loop()
   void loadChannels(DataStoreHost* host);
   void saveChannels(DataStoreHost* host);
   void migrateToSecondaryFS();
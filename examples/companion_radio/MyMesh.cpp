@@ -398,7 +398,7 @@ ContactInfo*  MyMesh::processAck(const uint8_t *data) {
 
       // NOTE: the same ACK can be received multiple times!
       expected_ack_table[i].ack = 0; // clear expected hash, now that we have received ACK
-      return expected_ack_table[i].contact;
+      return lookupContactByPubKey(expected_ack_table[i].pub_key, PUB_KEY_SIZE);
     }
   }
   return checkConnectionsAck(data);
@@ -744,6 +744,8 @@ void MyMesh::onRawDataRecv(mesh::Packet *packet) {
 
 void MyMesh::onTraceRecv(mesh::Packet *packet, uint32_t tag, uint32_t auth_code, uint8_t flags,
                          const uint8_t *path_snrs, const uint8_t *path_hashes, uint8_t path_len) {
+  onPathTraced(path_hashes, path_snrs, path_len, flags);
+
   uint8_t path_sz = flags & 0x03;  // NEW v1.11+
   if (12 + path_len + (path_len >> path_sz) + 1 > sizeof(out_frame)) {
     MESH_DEBUG_PRINTLN("onTraceRecv(), path_len is too long: %d", (uint32_t)path_len);
@@ -917,7 +919,7 @@ void MyMesh::handleCmdFrame(size_t len) {
     int i = 0;
     out_frame[i++] = RESP_CODE_DEVICE_INFO;
     out_frame[i++] = FIRMWARE_VER_CODE;
-    out_frame[i++] = MAX_CONTACTS / 2;   // v3+
+    out_frame[i++] = MAX_CONTACTS / 2 > 255 ? 255 : MAX_CONTACTS / 2;   // v3+  NOTE: can't report more than 510
     out_frame[i++] = MAX_GROUP_CHANNELS; // v3+
     memcpy(&out_frame[i], &_prefs.ble_pin, 4);
     i += 4;
@@ -1003,7 +1005,7 @@ void MyMesh::handleCmdFrame(size_t len) {
         if (expected_ack) {
           expected_ack_table[next_ack_idx].msg_sent = _ms->getMillis(); // add to circular table
           expected_ack_table[next_ack_idx].ack = expected_ack;
-          expected_ack_table[next_ack_idx].contact = recipient;
+          memcpy(expected_ack_table[next_ack_idx].pub_key, recipient->id.pub_key, PUB_KEY_SIZE);
           next_ack_idx = (next_ack_idx + 1) % EXPECTED_ACK_TABLE_SIZE;
         }
 
@@ -1118,7 +1120,7 @@ void MyMesh::handleCmdFrame(size_t len) {
     uint8_t *pub_key = &cmd_frame[1];
     ContactInfo *recipient = lookupContactByPubKey(pub_key, PUB_KEY_SIZE);
     if (recipient) {
-      recipient->out_path_len = -1;
+      resetPathTo(*recipient);
       // recipient->lastmod = ??   shouldn't be needed, app already has this version of contact
       dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
       writeOKFrame();
@@ -1132,6 +1134,7 @@ void MyMesh::handleCmdFrame(size_t len) {
     if (recipient) {
       updateContactFromFrame(*recipient, last_mod, cmd_frame, len);
       recipient->lastmod = last_mod;
+      reindexContact(*recipient);
       dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
       writeOKFrame();
     } else {
@@ -1821,11 +1824,12 @@ void MyMesh::checkCLIRescueCmd() {
         Serial.printf("  Error: unknown config: %s\n", config);
       }
     } else if (strcmp(cli_command, "rebuild") == 0) {
-      bool success = _store->formatFileSystem();
-      if (success) {
+      if (!cacheAllContacts()) {   // they must all be held in RAM while the filesystem is wiped
+        Serial.printf("  Error: too many contacts to rebuild (max %d)\n", CONTACT_CACHE_SIZE);
+      } else if (_store->formatFileSystem()) {
         _store->saveMainIdentity(self_id);
         savePrefs();
-        saveContacts();
+        rewriteAllContacts();
         saveChannels();
         Serial.println("  > erase and rebuild done");
       } else {
@@ -1974,12 +1978,10 @@ void MyMesh::checkSerialInterface() {
              && !_serial->isWriteBusy() // don't spam the Serial Interface too quickly!
   ) {
     ContactInfo contact;
-    if (_iter.hasNext(this, contact)) {
-      if (contact.lastmod > _iter_filter_since) { // apply the 'since' filter
-        writeContactRespFrame(RESP_CODE_CONTACT, contact);
-        if (contact.lastmod > _most_recent_lastmod) {
-          _most_recent_lastmod = contact.lastmod; // save for the RESP_CODE_END_OF_CONTACTS frame
-        }
+    if (_iter.hasNext(this, contact, _iter_filter_since)) { // apply the 'since' filter
+      writeContactRespFrame(RESP_CODE_CONTACT, contact);
+      if (contact.lastmod > _most_recent_lastmod) {
+        _most_recent_lastmod = contact.lastmod; // save for the RESP_CODE_END_OF_CONTACTS frame
       }
     } else { // EOF
       out_frame[0] = RESP_CODE_END_OF_CONTACTS;
@@ -2006,6 +2008,8 @@ void MyMesh::loop() {
   if (dirty_contacts_expiry && millisHasNowPassed(dirty_contacts_expiry)) {
     saveContacts();
     dirty_contacts_expiry = 0;
+  } else if (_store->isContactsCompactionDue()) {
+    _store->compactContactsStep();   // fold contacts journal back into main file, a few records at a time
   }
 
 #ifdef DISPLAY_CLASS
@@ -55,10 +55,6 @@
 #define MAX_LORA_TX_POWER LORA_TX_POWER
 #endif
 
-#ifndef MAX_CONTACTS
-#define MAX_CONTACTS 100
-#endif
-
 #ifndef OFFLINE_QUEUE_SIZE
 #define OFFLINE_QUEUE_SIZE 16
 #endif
@@ -148,8 +144,7 @@ protected:
   void onSendTimeout() override;
 
   // DataStoreHost methods
-  bool onContactLoaded(const ContactInfo& contact) override { return addContact(contact); }
-  bool getContactForSave(uint32_t idx, ContactInfo& contact) override { return getContactByIdx(idx, contact); }
+  bool onContactLoaded(const ContactInfo& contact, uint32_t rec_id) override { return loadContact(contact, rec_id); }
   bool onChannelLoaded(uint8_t channel_idx, const ChannelDetails& ch) override { return setChannel(channel_idx, ch); }
   bool getChannelForSave(uint8_t channel_idx, ChannelDetails& ch) override { return getChannel(channel_idx, ch); }
 
@@ -174,6 +169,13 @@ private:
   bool putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], int len) override {
     return _store->putBlobByKey(key, key_len, src_buf, len);
   }
+  bool readContactRecord(uint32_t rec_id, ContactInfo& dest) override {
+    return _store->readContactRecord(rec_id, dest);
+  }
+  bool writeContactRecord(uint32_t rec_id, const ContactInfo& src) override {
+    return _store->writeContactRecord(rec_id, src);
+  }
+  void deleteContactRecord(uint32_t rec_id) override { _store->deleteContactRecord(rec_id); }
 
   void checkCLIRescueCmd();
   void checkSerialInterface();
@@ -181,7 +183,7 @@ private:
 
   // helpers, short-cuts
   void saveChannels() { _store->saveChannels(this); }
-  void saveContacts() { _store->saveContacts(this); }
+  void saveContacts() { flushContacts(); }
 
   DataStore* _store;
   NodePrefs _prefs;
@@ -222,7 +224,7 @@ private:
   struct AckTableEntry {
     unsigned long msg_sent;
     uint32_t ack;
-    ContactInfo* contact;
+    uint8_t pub_key[PUB_KEY_SIZE];   // NOTE: not ContactInfo*, as contact may be paged out by the time ACK arrives
   };
   #define EXPECTED_ACK_TABLE_SIZE 8
   AckTableEntry expected_ack_table[EXPECTED_ACK_TABLE_SIZE]; // circular table
@@ -49,6 +49,7 @@
 #define REQ_TYPE_GET_ACCESS_LIST    0x05
 #define REQ_TYPE_GET_NEIGHBOURS     0x06
 #define REQ_TYPE_GET_OWNER_INFO     0x07     // FIRMWARE_VER_LEVEL >= 2
+#define REQ_TYPE_GET_STATS_HISTORY  0x08
 
 #define RESP_SERVER_LOGIN_OK        0 // response to ANON_REQ
 
@@ -60,30 +61,17 @@
 
 #define LAZY_CONTACTS_WRITE_DELAY    5000
 
-void MyMesh::putNeighbour(const mesh::Identity &id, uint32_t timestamp, float snr) {
-#if MAX_NEIGHBOURS // check if neighbours enabled
-  // find existing neighbour, else use least recently updated
-  uint32_t oldest_timestamp = 0xFFFFFFFF;
-  NeighbourInfo *neighbour = &neighbours[0];
-  for (int i = 0; i < MAX_NEIGHBOURS; i++) {
-    // if neighbour already known, we should update it
-    if (id.matches(neighbours[i].id)) {
-      neighbour = &neighbours[i];
-      break;
-    }
+#define TX_WINDOW_UPDATE_MILLIS      60000
+#define STATS_HISTORY_MILLIS         60000
+#define ACTIVE_NEIGHBOUR_SECS        (30*60)   // for contention window
 
-    // otherwise we should update the least recently updated neighbour
-    if (neighbours[i].heard_timestamp < oldest_timestamp) {
-      neighbour = &neighbours[i];
-      oldest_timestamp = neighbour->heard_timestamp;
-    }
-  }
+#ifndef FLOOD_DEFER_FACTOR
+  #define FLOOD_DEFER_FACTOR         4    // retransmit window multiplier, for sources over their flood rate
+#endif
 
-  // update neighbour info
-  neighbour->id = id;
-  neighbour->advert_timestamp = timestamp;
-  neighbour->heard_timestamp = getRTCClock()->getCurrentTime();
-  neighbour->snr = (int8_t)(snr * 4);
+void MyMesh::putNeighbour(const mesh::Identity &id, uint32_t timestamp, float snr, float rssi) {
+#if MAX_NEIGHBOURS // check if neighbours enabled
+  neighbour_table.put(id, timestamp, getRTCClock()->getCurrentTime(), snr, rssi);
 #endif
 }
 
@@ -268,8 +256,8 @@ int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t
     }
   }
   if (payload[0] == REQ_TYPE_GET_NEIGHBOURS) {
-    uint8_t request_version = payload[1];
-    if (request_version == 0) {
+    uint8_t request_version = payload[1];   // 0 = basic, 1 = with link stats
+    if (request_version == 0 || request_version == 1) {
 
       // reply data offset (after response sender_timestamp/tag)
       int reply_offset = 4;
@@ -278,7 +266,7 @@ int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t
       uint8_t count = payload[2]; // how many neighbours to fetch (0-255)
       uint16_t offset;
       memcpy(&offset, &payload[3], 2); // offset from start of neighbours list (0-65535)
-      uint8_t order_by = payload[5]; // how to order neighbours. 0=newest_to_oldest, 1=oldest_to_newest, 2=strongest_to_weakest, 3=weakest_to_strongest
+      uint8_t order_by = payload[5]; // how to order neighbours. 0=newest_to_oldest, 1=oldest_to_newest, 2=strongest_to_weakest, 3=weakest_to_strongest, 4=most_heard
       uint8_t pubkey_prefix_length = payload[6]; // how many bytes of neighbour pub key we want
       // we also send a 4 byte random blob in payload[7...10] to help packet uniqueness
 
@@ -291,15 +279,8 @@ int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t
       }
 
       // create copy of neighbours list, skipping empty entries so we can sort it separately from main list
-      int16_t neighbours_count = 0;
       NeighbourInfo* sorted_neighbours[MAX_NEIGHBOURS];
-      for (int i = 0; i < MAX_NEIGHBOURS; i++) {
-        auto neighbour = &neighbours[i];
-        if (neighbour->heard_timestamp > 0) {
-          sorted_neighbours[neighbours_count] = neighbour;
-          neighbours_count++;
-        }
-      }
+      int16_t neighbours_count = neighbour_table.getAll(sorted_neighbours);
 
       // sort neighbours based on order
       if (order_by == 0) {
@@ -326,6 +307,11 @@ int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t
         std::sort(sorted_neighbours, sorted_neighbours + neighbours_count, [](const NeighbourInfo* a, const NeighbourInfo* b) {
           return a->snr < b->snr; // asc
         });
+      } else if (order_by == 4) {
+        MESH_DEBUG_PRINTLN("REQ_TYPE_GET_NEIGHBOURS sorting most heard first");
+        std::sort(sorted_neighbours, sorted_neighbours + neighbours_count, [](const NeighbourInfo* a, const NeighbourInfo* b) {
+          return a->num_heard > b->num_heard; // desc
+        });
       }
 
       // build results buffer
@@ -335,7 +321,7 @@ int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t
       for(int index = 0; index < count && index + offset < neighbours_count; index++){
         
         // stop if we can't fit another entry in results
-        int entry_size = pubkey_prefix_length + 4 + 1;
+        int entry_size = request_version == 1 ? NEIGHBOUR_EXPORT_REC_SIZE : pubkey_prefix_length + 4 + 1;
         if(results_offset + entry_size > sizeof(results_buffer)){
           MESH_DEBUG_PRINTLN("REQ_TYPE_GET_NEIGHBOURS no more entries can fit in results buffer");
           break;
@@ -343,6 +329,11 @@ int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t
 
         // add next neighbour to results
         auto neighbour = sorted_neighbours[index + offset];
+        if (request_version == 1) {   // fixed size records, with link stats
+          results_offset += NeighbourTable::exportEntry(*neighbour, getRTCClock()->getCurrentTime(), &results_buffer[results_offset]);
+          results_count++;
+          continue;
+        }
         uint32_t heard_seconds_ago = getRTCClock()->getCurrentTime() - neighbour->heard_timestamp;
         memcpy(&results_buffer[results_offset], neighbour->id.pub_key, pubkey_prefix_length); results_offset += pubkey_prefix_length;
         memcpy(&results_buffer[results_offset], &heard_seconds_ago, 4); results_offset += 4;
@@ -362,6 +353,14 @@ int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t
   } else if (payload[0] == REQ_TYPE_GET_OWNER_INFO) {
     sprintf((char *) &reply_data[4], "%s\n%s\n%s", FIRMWARE_VERSION, _prefs.node_name, _prefs.owner_info);
     return 4 + strlen((char *) &reply_data[4]);
+  } else if (payload[0] == REQ_TYPE_GET_STATS_HISTORY && payload[1] == 0) {   // request_version 0
+    uint16_t end_ago;
+    memcpy(&end_ago, &payload[2], 2);   // minutes before newest
+    uint8_t step = payload[4];          // minutes per record
+    uint8_t count = payload[5];         // max records
+    // we also send a 4 byte random blob in payload[6...9] to help packet uniqueness
+    return 4 + stats_history.exportRange(end_ago, step, count, &reply_data[4],
+                                         STATS_HISTORY_HEADER_SIZE + 12*STATS_HISTORY_REC_SIZE);   // eg. an hour, at 5 min steps
   }
   return 0; // unknown command
 }
@@ -373,14 +372,25 @@ mesh::Packet *MyMesh::createSelfAdvert() {
   return createAdvert(self_id, app_data, app_data_len);
 }
 
-File MyMesh::openAppend(const char *fname) {
-#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
-  return _fs->open(fname, FILE_O_WRITE);
-#elif defined(RP2040_PLATFORM)
-  return _fs->open(fname, "a");
-#else
-  return _fs->open(fname, "a", true);
-#endif
+uint32_t MyMesh::getFloodSourceKey(const mesh::Packet *packet) const {
+  switch (packet->getPayloadType()) {
+    case PAYLOAD_TYPE_ADVERT:
+    case PAYLOAD_TYPE_ANON_REQ: {
+      int i = packet->getPayloadType() == PAYLOAD_TYPE_ANON_REQ ? 1 : 0;   // skip dest_hash
+      if (packet->payload_len < i + 4) return 0;
+      uint32_t key;
+      memcpy(&key, &packet->payload[i], 4);   // pub_key prefix
+      return key ? key : 1;
+    }
+    case PAYLOAD_TYPE_REQ:
+    case PAYLOAD_TYPE_RESPONSE:
+    case PAYLOAD_TYPE_TXT_MSG:
+    case PAYLOAD_TYPE_PATH:
+      if (packet->payload_len < 2) return 0;
+      return 0x80000000 | packet->payload[1];   // src_hash. NOTE: senders sharing a hash byte share one budget
+    default:
+      return 0;   // eg. channel messages, no identifiable source
+  }
 }
 
 bool MyMesh::allowPacketForward(const mesh::Packet *packet) {
@@ -396,9 +406,54 @@ bool MyMesh::allowPacketForward(const mesh::Packet *packet) {
     }
     recv_pkt_region = &region_map.getWildcard();
   }
+  if (packet->isRouteFlood()) {
+    bool is_gossip = recv_pkt_region && (recv_pkt_region->flags & REGION_GOSSIP);
+    if (is_gossip && !gossip.shouldForward(packet, packet->getSNR(), tx_window.getNeighbours(), _prefs.gossip_prob, _prefs.gossip_hops, getRNG())) {
+      return false;   // before rate limit, so source isn't charged for floods we don't forward
+    }
+
+    int res = flood_src_limiter.check(getFloodSourceKey(packet), _ms->getMillis(), _prefs.flood_src_rate, _prefs.flood_src_burst);
+    if (res == RATE_DENY) {
+      MESH_DEBUG_PRINTLN("allowPacketForward: source over flood rate limit");
+      return false;
+    }
+    recv_pkt_deferred = res == RATE_DEFER;   // applied by getRetransmitDelay()
+
+    if (is_gossip) {
+      gossip.onQueued(packet);   // may yet be cancelled, if enough others are heard forwarding it
+    }
+  }
   return true;
 }
 
+void MyMesh::getStatsTotals(StatsTotals& totals) {
+  totals.tx_air_ms = getTotalAirTime();
+  totals.rx_air_ms = getReceiveAirTime();
+  totals.n_recv_flood = getNumRecvFlood();
+  totals.n_sent_flood = getNumSentFlood();
+  totals.n_recv_direct = getNumRecvDirect();
+  totals.n_sent_direct = getNumSentDirect();
+  totals.n_dups = ((SimpleMeshTables *)getTables())->getNumFloodDups() + ((SimpleMeshTables *)getTables())->getNumDirectDups();
+}
+
+void MyMesh::cancelQueuedFlood(const mesh::Packet *queued, const mesh::Packet *heard) {
+  uint8_t hash[MAX_HASH_SIZE], queued_hash[MAX_HASH_SIZE];
+  heard->calculatePacketHash(hash);
+
+  int n = _mgr->getOutboundCount(0xFFFFFFFF);
+  for (int i = 0; i < n; i++) {
+    auto pkt = _mgr->getOutboundByIdx(i);
+    if (pkt == queued) {
+      pkt->calculatePacketHash(queued_hash);
+      if (!pkt->isRouteFlood() || memcmp(hash, queued_hash, MAX_HASH_SIZE) != 0) break;   // instance has been re-used
+
+      releasePacket(_mgr->removeOutboundByIdx(i));
+      gossip.onCancelled();
+      break;
+    }
+  }
+}
+
 const char *MyMesh::getLogDateTime() {
   static char tmp[32];
   uint32_t now = getRTCClock()->getCurrentTime();
@@ -415,6 +470,9 @@ void MyMesh::logRxRaw(float snr, float rssi, const uint8_t raw[], int len) {
   mesh::Utils::printHex(Serial, raw, len);
   Serial.println();
 #endif
+#ifdef WITH_PCAP_CAPTURE
+  captureFrame(snr, rssi, raw, len, false);
+#endif
 }
 
 void MyMesh::logRx(mesh::Packet *pkt, int len, float score) {
@@ -425,21 +483,20 @@ void MyMesh::logRx(mesh::Packet *pkt, int len, float score) {
 #endif
 
   if (_logging) {
-    File f = openAppend(PACKET_LOG_FILE);
-    if (f) {
-      f.print(getLogDateTime());
-      f.printf(": RX, len=%d (type=%d, route=%s, payload_len=%d) SNR=%d RSSI=%d score=%d", len,
-               pkt->getPayloadType(), pkt->isRouteDirect() ? "D" : "F", pkt->payload_len,
-               (int)_radio->getLastSNR(), (int)_radio->getLastRSSI(), (int)(score * 1000));
-
-      if (pkt->getPayloadType() == PAYLOAD_TYPE_PATH || pkt->getPayloadType() == PAYLOAD_TYPE_REQ ||
-          pkt->getPayloadType() == PAYLOAD_TYPE_RESPONSE || pkt->getPayloadType() == PAYLOAD_TYPE_TXT_MSG) {
-        f.printf(" [%02X -> %02X]\n", (uint32_t)pkt->payload[1], (uint32_t)pkt->payload[0]);
-      } else {
-        f.printf("\n");
-      }
-      f.close();
-    }
+    packet_log.add(PKT_LOG_RX, getRTCClock()->getCurrentTime(), _ms->getMillis(), pkt, len,
+                   _radio->getLastSNR(), _radio->getLastRSSI(), score);
+  }
+
+#if MAX_NEIGHBOURS
+  if (pkt->isRouteFlood() && pkt->path_len > 0) {   // last hop in path is who we heard it from
+    neighbour_table.onHeard(pkt->path[pkt->path_len - 1], getRTCClock()->getCurrentTime(), _radio->getLastSNR(), _radio->getLastRSSI());
+  } else if (pkt->isRouteDirect()) {
+    neighbour_table.onDirectRecv(pkt);   // maybe next hop passing on one we sent
+  }
+#endif
+  if (pkt->isRouteFlood()) {
+    auto queued = gossip.onHeard(pkt, _prefs.gossip_dups);
+    if (queued) cancelQueuedFlood(queued, pkt);   // enough others have forwarded it
   }
 }
 
@@ -451,33 +508,27 @@ void MyMesh::logTx(mesh::Packet *pkt, int len) {
 #endif
 
   if (_logging) {
-    File f = openAppend(PACKET_LOG_FILE);
-    if (f) {
-      f.print(getLogDateTime());
-      f.printf(": TX, len=%d (type=%d, route=%s, payload_len=%d)", len, pkt->getPayloadType(),
-               pkt->isRouteDirect() ? "D" : "F", pkt->payload_len);
-
-      if (pkt->getPayloadType() == PAYLOAD_TYPE_PATH || pkt->getPayloadType() == PAYLOAD_TYPE_REQ ||
-          pkt->getPayloadType() == PAYLOAD_TYPE_RESPONSE || pkt->getPayloadType() == PAYLOAD_TYPE_TXT_MSG) {
-        f.printf(" [%02X -> %02X]\n", (uint32_t)pkt->payload[1], (uint32_t)pkt->payload[0]);
-      } else {
-        f.printf("\n");
-      }
-      f.close();
-    }
+    packet_log.add(PKT_LOG_TX, getRTCClock()->getCurrentTime(), _ms->getMillis(), pkt, len);
+  }
+#if MAX_NEIGHBOURS
+  if (pkt->isRouteDirect() && pkt->getPayloadType() != PAYLOAD_TYPE_TRACE) {
+    neighbour_table.onDirectSent(pkt, _ms->getMillis());
   }
+#endif
+  gossip.onSent(pkt);
+#ifdef WITH_PCAP_CAPTURE
+  if (pcap.isActive()) {
+    uint8_t raw[MAX_TRANS_UNIT];
+    captureFrame(0, 0, raw, pkt->writeTo(raw), true);
+  }
+#endif
 }
 
 void MyMesh::logTxFail(mesh::Packet *pkt, int len) {
   if (_logging) {
-    File f = openAppend(PACKET_LOG_FILE);
-    if (f) {
-      f.print(getLogDateTime());
-      f.printf(": TX FAIL!, len=%d (type=%d, route=%s, payload_len=%d)\n", len, pkt->getPayloadType(),
-               pkt->isRouteDirect() ? "D" : "F", pkt->payload_len);
-      f.close();
-    }
+    packet_log.add(PKT_LOG_TX_FAIL, getRTCClock()->getCurrentTime(), _ms->getMillis(), pkt, len);
   }
+  gossip.onSent(pkt);   // is released after this, so must no longer be watched
 }
 
 int MyMesh::calcRxDelay(float score, uint32_t air_time) const {
@@ -486,7 +537,12 @@ int MyMesh::calcRxDelay(float score, uint32_t air_time) const {
 }
 
 uint32_t MyMesh::getRetransmitDelay(const mesh::Packet *packet) {
-  uint32_t t = (_radio->getEstAirtimeFor(packet->path_len + packet->payload_len + 2) * _prefs.tx_delay_factor);
+  // window adapts to how many neighbours are likely forwarding the same flood
+  uint32_t t = (_radio->getEstAirtimeFor(packet->path_len + packet->payload_len + 2) * _prefs.tx_delay_factor * tx_window.getScale());
+  if (recv_pkt_deferred) {   // source is over its rate, so let other traffic go first
+    recv_pkt_deferred = false;
+    return 5*t + getRNG()->nextInt(0, FLOOD_DEFER_FACTOR*5*t + 1);
+  }
   return getRNG()->nextInt(0, 5*t + 1);
 }
 uint32_t MyMesh::getDirectRetransmitDelay(const mesh::Packet *packet) {
@@ -586,7 +642,7 @@ void MyMesh::onAdvertRecv(mesh::Packet *packet, const mesh::Identity &id, uint32
   if (packet->path_len == 0 && !isShare(packet)) {
     AdvertDataParser parser(app_data, app_data_len);
     if (parser.isValid() && parser.getType() == ADV_TYPE_REPEATER) { // just keep neigbouring Repeaters
-      putNeighbour(id, timestamp, packet->getSNR());
+      putNeighbour(id, timestamp, packet->getSNR(), _radio->getLastRSSI());
     }
   }
 }
@@ -750,9 +806,12 @@ void MyMesh::onControlDataRecv(mesh::Packet* packet) {
 MyMesh::MyMesh(mesh::MainBoard &board, mesh::Radio &radio, mesh::MillisecondClock &ms, mesh::RNG &rng,
                mesh::RTCClock &rtc, mesh::MeshTables &tables)
     : mesh::Mesh(radio, ms, rng, rtc, *new StaticPoolPacketManager(32), tables),
-      _cli(board, rtc, sensors, acl, &_prefs, this), telemetry(MAX_PACKET_PAYLOAD - 4), region_map(key_store), temp_map(key_store),
+      packet_log(PACKET_LOG_FILE), _cli(board, rtc, sensors, acl, &_prefs, this), telemetry(MAX_PACKET_PAYLOAD - 4), region_map(key_store), temp_map(key_store),
       discover_limiter(4, 120),  // max 4 every 2 minutes
       anon_limiter(4, 180)   // max 4 every 3 minutes
+#if MAX_NEIGHBOURS
+      , neighbour_table(neighbours, MAX_NEIGHBOURS)
+#endif
 #if defined(WITH_RS232_BRIDGE)
       , bridge(&_prefs, WITH_RS232_BRIDGE, _mgr, &rtc)
 #endif
@@ -770,10 +829,9 @@ MyMesh::MyMesh(mesh::MainBoard &board, mesh::Radio &radio, mesh::MillisecondCloc
   set_radio_at = revert_radio_at = 0;
   _logging = false;
   region_load_active = false;
-
-#if MAX_NEIGHBOURS
-  memset(neighbours, 0, sizeof(neighbours));
-#endif
+  recv_pkt_deferred = false;
+  next_tx_window_update = 0;
+  next_stats_minute = 0;
 
   // defaults
   memset(&_prefs, 0, sizeof(_prefs));
@@ -793,6 +851,11 @@ MyMesh::MyMesh(mesh::MainBoard &board, mesh::Radio &radio, mesh::MillisecondCloc
   _prefs.advert_interval = 1;        // default to 2 minutes for NEW installs
   _prefs.flood_advert_interval = 12; // 12 hours
   _prefs.flood_max = 64;
+  _prefs.flood_src_rate = 0;    // off by default: most sources are only known by 1 byte hash (see getFloodSourceKey())
+  _prefs.flood_src_burst = 20;
+  _prefs.gossip_prob = 65;
+  _prefs.gossip_hops = 2;
+  _prefs.gossip_dups = 2;
   _prefs.interference_threshold = 0; // disabled
 
   // bridge defaults
@@ -816,6 +879,10 @@ MyMesh::MyMesh(mesh::MainBoard &board, mesh::Radio &radio, mesh::MillisecondCloc
 void MyMesh::begin(FILESYSTEM *fs) {
   mesh::Mesh::begin();
   _fs = fs;
+  packet_log.begin(_fs);
+#if defined(WITH_PCAP_CAPTURE) && defined(PCAP_CAPTURE_STREAM)
+  pcap.begin(PCAP_CAPTURE_STREAM, getRTCClock()->getCurrentTime(), _ms->getMillis());
+#endif
   // load persisted prefs
   _cli.loadPrefs(_fs);
   acl.load(_fs, self_id);
@@ -899,20 +966,69 @@ void MyMesh::updateFloodAdvertTimer() {
 }
 
 void MyMesh::dumpLogFile() {
-#if defined(RP2040_PLATFORM)
-  File f = _fs->open(PACKET_LOG_FILE, "r");
-#else
-  File f = _fs->open(PACKET_LOG_FILE);
+  packet_log.dump(Serial);
+}
+
+#ifdef WITH_PCAP_CAPTURE
+void MyMesh::setCaptureOn(bool enable) {
+#ifndef PCAP_CAPTURE_STREAM   // otherwise, is always on
+  if (enable && !pcap.isActive()) {
+  #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+    pcap_file = _fs->open(PCAP_CAPTURE_FILE, FILE_O_WRITE);
+  #elif defined(RP2040_PLATFORM)
+    pcap_file = _fs->open(PCAP_CAPTURE_FILE, "a");
+  #else
+    pcap_file = _fs->open(PCAP_CAPTURE_FILE, "a", true);
+  #endif
+    // each capture session is appended as a new pcapng section
+    if (pcap_file && pcap.begin(pcap_file, getRTCClock()->getCurrentTime(), _ms->getMillis())) {
+      next_pcap_flush = futureMillis(PACKET_LOG_FLUSH_MILLIS);
+    } else {
+      MESH_DEBUG_PRINTLN("ERROR: unable to start pcap capture");
+      if (pcap_file) pcap_file.close();
+    }
+  } else if (!enable && pcap.isActive()) {
+    pcap.end();
+    pcap_file.close();
+  }
 #endif
+}
+
+void MyMesh::captureFrame(float snr, float rssi, const uint8_t raw[], int len, bool is_tx) {
+  if (!pcap.isActive()) return;
+
+  LoRaFrameMeta meta;
+  meta.snr = snr;
+  meta.rssi = rssi;
+  meta.freq = _prefs.freq;
+  meta.bw = _prefs.bw;
+  meta.sf = _prefs.sf;
+  meta.cr = _prefs.cr;
+  meta.airtime = _radio->getEstAirtimeFor(len);
+  meta.is_tx = is_tx;
+  pcap.writeFrame(meta, _ms->getMillis(), raw, len);
+}
+
+void MyMesh::dumpCaptureFile() {
+#ifndef PCAP_CAPTURE_STREAM
+  if (pcap.isActive()) pcap_file.flush();
+
+ #if defined(RP2040_PLATFORM)
+  File f = _fs->open(PCAP_CAPTURE_FILE, "r");
+ #else
+  File f = _fs->open(PCAP_CAPTURE_FILE);
+ #endif
   if (f) {
-    while (f.available()) {
-      int c = f.read();
-      if (c < 0) break;
-      Serial.print((char)c);
+    uint8_t buf[64];
+    int n;
+    while ((n = f.read(buf, sizeof(buf))) > 0) {
+      Serial.write(buf, n);
     }
     f.close();
   }
+#endif
 }
+#endif
 
 void MyMesh::setTxPower(int8_t power_dbm) {
   radio_set_tx_power(power_dbm);
@@ -923,15 +1039,8 @@ void MyMesh::formatNeighborsReply(char *reply) {
 
 #if MAX_NEIGHBOURS
   // create copy of neighbours list, skipping empty entries so we can sort it separately from main list
-  int16_t neighbours_count = 0;
   NeighbourInfo* sorted_neighbours[MAX_NEIGHBOURS];
-  for (int i = 0; i < MAX_NEIGHBOURS; i++) {
-    auto neighbour = &neighbours[i];
-    if (neighbour->heard_timestamp > 0) {
-      sorted_neighbours[neighbours_count] = neighbour;
-      neighbours_count++;
-    }
-  }
+  int16_t neighbours_count = neighbour_table.getAll(sorted_neighbours);
 
   // sort neighbours newest to oldest
   std::sort(sorted_neighbours, sorted_neighbours + neighbours_count, [](const NeighbourInfo* a, const NeighbourInfo* b) {
@@ -964,12 +1073,7 @@ void MyMesh::formatNeighborsReply(char *reply) {
 
 void MyMesh::removeNeighbor(const uint8_t *pubkey, int key_len) {
 #if MAX_NEIGHBOURS
-  for (int i = 0; i < MAX_NEIGHBOURS; i++) {
-    NeighbourInfo *neighbour = &neighbours[i];
-    if (memcmp(neighbour->id.pub_key, pubkey, key_len) == 0) {
-      neighbours[i] = NeighbourInfo(); // clear neighbour entry
-    }
-  }
+  neighbour_table.remove(pubkey, key_len);
 #endif
 }
 
@@ -1003,12 +1107,20 @@ void MyMesh::clearStats() {
   radio_driver.resetStats();
   resetStats();
   ((SimpleMeshTables *)getTables())->resetStats();
+  key_store.resetStats();
+  flood_src_limiter.resetStats();
+  gossip.resetStats();
+
+  StatsTotals totals;
+  getStatsTotals(totals);
+  stats_history.begin(totals);   // current minute starts from zero
 }
 
 void MyMesh::handleCommand(uint32_t sender_timestamp, char *command, char *reply) {
   if (region_load_active) {
     if (StrHelper::isBlank(command)) {  // empty/blank line, signal to terminate 'load' operation
       region_map = temp_map;  // copy over the temp instance as new current map
+      key_store.invalidateCache();   // region ids may have been re-assigned
       region_load_active = false;
 
       sprintf(reply, "OK - loaded %d regions", region_map.getCount());
@@ -1030,6 +1142,7 @@ void MyMesh::handleCommand(uint32_t sender_timestamp, char *command, char *reply
           auto nw = temp_map.putRegion(np, parent->id, old ? old->id : 0);  // carry-over the current ID (if name already exists)
           if (nw) {
             nw->flags = old ? old->flags : (*ep == 'F' ? 0 : REGION_DENY_FLOOD);   // carry-over flags from curr
+            if (!old && *ep == 'F' && ep[1] == 'G') nw->flags |= REGION_GOSSIP;
 
             load_stack[indent] = nw;  // keep pointers to parent regions, to resolve parent_id's
           }
@@ -1082,6 +1195,13 @@ void MyMesh::handleCommand(uint32_t sender_timestamp, char *command, char *reply
       Serial.printf("\n");
     }
     reply[0] = 0;
+  } else if (sender_timestamp == 0 && strcmp(command, "stats-flood") == 0) {
+    sprintf(reply, "{\"tx_window_pct\":%d,\"active_neighbours\":%d,\"flood_dup_pct\":%d,\"src_deferred\":%u,\"src_dropped\":%u,\"src_evicted\":%u}",
+            (int)(tx_window.getScale() * 100), tx_window.getNeighbours(), tx_window.getDupPercent(),
+            flood_src_limiter.getNumDeferred(), flood_src_limiter.getNumDenied(), flood_src_limiter.getNumEvicted());
+  } else if (sender_timestamp == 0 && strcmp(command, "stats-gossip") == 0) {
+    sprintf(reply, "{\"forwarded\":%u,\"skipped\":%u,\"cancelled\":%u}",
+            gossip.getNumForwarded(), gossip.getNumSkipped(), gossip.getNumCancelled());
   } else if (memcmp(command, "region", 6) == 0) {
     reply[0] = 0;
 
@@ -1107,6 +1227,19 @@ void MyMesh::handleCommand(uint32_t sender_timestamp, char *command, char *reply
       } else {
         strcpy(reply, "Err - unknown region");
       }
+    } else if (n >= 3 && strcmp(parts[1], "gossip") == 0) {
+      auto region = region_map.findByNamePrefix(parts[2]);
+      if (region == NULL) {
+        strcpy(reply, "Err - unknown region");
+      } else if (n >= 4 && strcmp(parts[3], "off") == 0) {
+        region->flags &= ~REGION_GOSSIP;
+        strcpy(reply, "OK");
+      } else if (n >= 4 && strcmp(parts[3], "on") == 0) {
+        region->flags |= REGION_GOSSIP;
+        strcpy(reply, "OK");
+      } else {
+        sprintf(reply, " %s gossip is %s", region->name, (region->flags & REGION_GOSSIP) ? "on" : "off");
+      }
     } else if (n >= 3 && strcmp(parts[1], "denyf") == 0) {
       auto region = region_map.findByNamePrefix(parts[2]);
       if (region) {
@@ -1120,9 +1253,10 @@ void MyMesh::handleCommand(uint32_t sender_timestamp, char *command, char *reply
       if (region) {
         auto parent = region_map.findById(region->parent);
         if (parent && parent->id != 0) {
-          sprintf(reply, " %s (%s) %s", region->name, parent->name, (region->flags & REGION_DENY_FLOOD) ? "" : "F");
+          sprintf(reply, " %s (%s) %s%s", region->name, parent->name, (region->flags & REGION_DENY_FLOOD) ? "" : "F",
+                  (region->flags & REGION_GOSSIP) ? "G" : "");
         } else {
-          sprintf(reply, " %s %s", region->name, (region->flags & REGION_DENY_FLOOD) ? "" : "F");
+          sprintf(reply, " %s %s%s", region->name, (region->flags & REGION_DENY_FLOOD) ? "" : "F", (region->flags & REGION_GOSSIP) ? "G" : "");
         }
       } else {
         strcpy(reply, "Err - unknown region");
@@ -1180,6 +1314,9 @@ void MyMesh::handleCommand(uint32_t sender_timestamp, char *command, char *reply
       if (len == 0) {
         strcpy(reply, "-none-");
       }
+    } else if (n >= 2 && strcmp(parts[1], "cache") == 0) {
+      sprintf(reply, "key cache: hits=%u, misses=%u, evictions=%u", key_store.getNumCacheHits(),
+              key_store.getNumCacheMisses(), key_store.getNumCacheEvictions());
     } else {
       strcpy(reply, "Err - ??");
     }
@@ -1195,6 +1332,32 @@ void MyMesh::loop() {
 
   mesh::Mesh::loop();
 
+#if MAX_NEIGHBOURS
+  neighbour_table.expireForwards(_ms->getMillis());
+#endif
+
+  if (millisHasNowPassed(next_tx_window_update)) {
+  #if MAX_NEIGHBOURS
+    int active = neighbour_table.countActive(getRTCClock()->getCurrentTime() - ACTIVE_NEIGHBOUR_SECS);
+  #else
+    int active = -1;   // unknown
+  #endif
+    tx_window.update(active, getNumRecvFlood(), ((SimpleMeshTables *)getTables())->getNumFloodDups());
+    next_tx_window_update = futureMillis(TX_WINDOW_UPDATE_MILLIS);
+  }
+
+  stats_history.sampleQueue(_mgr->getOutboundCount(0xFFFFFFFF), _mgr->getFreeCount());
+  if (next_stats_minute == 0 || millisHasNowPassed(next_stats_minute)) {
+    StatsTotals totals;
+    getStatsTotals(totals);
+    if (next_stats_minute == 0) {
+      stats_history.begin(totals);
+    } else {
+      stats_history.endMinute(totals, _radio->getNoiseFloor(), getRTCClock()->getCurrentTime());
+    }
+    next_stats_minute = futureMillis(STATS_HISTORY_MILLIS);
+  }
+
   if (next_flood_advert && millisHasNowPassed(next_flood_advert)) {
     mesh::Packet *pkt = createSelfAdvert();
     if (pkt) sendFlood(pkt);
@@ -1226,6 +1389,14 @@ void MyMesh::loop() {
     dirty_contacts_expiry = 0;
   }
 
+  packet_log.loop(_ms->getMillis());   // batched append of buffered log records
+#if defined(WITH_PCAP_CAPTURE) && !defined(PCAP_CAPTURE_STREAM)
+  if (pcap.isActive() && millisHasNowPassed(next_pcap_flush)) {
+    pcap_file.flush();
+    next_pcap_flush = futureMillis(PACKET_LOG_FLUSH_MILLIS);
+  }
+#endif
+
   // update uptime
   uint32_t now = millis();
   uptime_millis += now - last_millis;
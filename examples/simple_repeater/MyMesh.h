@@ -31,6 +31,7 @@
 #include <helpers/AdvertDataHelpers.h>
 #include <helpers/ArduinoHelpers.h>
 #include <helpers/ClientACL.h>
+#include <helpers/PacketLog.h>
 #include <helpers/CommonCLI.h>
 #include <helpers/IdentityStore.h>
 #include <helpers/SimpleMeshTables.h>
@@ -38,7 +39,12 @@
 #include <helpers/StatsFormatHelper.h>
 #include <helpers/TxtDataHelpers.h>
 #include <helpers/RegionMap.h>
+#include <helpers/NeighbourTable.h>
+#include <helpers/ContentionWindow.h>
 #include "RateLimiter.h"
+#include <helpers/SourceRateLimiter.h>
+#include <helpers/GossipPolicy.h>
+#include <helpers/StatsHistory.h>
 
 #ifdef WITH_BRIDGE
 extern AbstractBridge* bridge;
@@ -66,13 +72,6 @@ struct RepeaterStats {
   #define MAX_CLIENTS           32
 #endif
 
-struct NeighbourInfo {
-  mesh::Identity id;
-  uint32_t advert_timestamp;
-  uint32_t heard_timestamp;
-  int8_t snr; // multiplied by 4, user should divide to get float value
-};
-
 #ifndef FIRMWARE_BUILD_DATE
   #define FIRMWARE_BUILD_DATE   "15 Feb 2026"
 #endif
@@ -83,7 +82,13 @@ struct NeighbourInfo {
 
 #define FIRMWARE_ROLE "repeater"
 
-#define PACKET_LOG_FILE  "/packet_log"
+#define PACKET_LOG_FILE  "/pkt_log"
+#define LEGACY_PACKET_LOG_FILE  "/packet_log"   // old text format
+
+#ifdef WITH_PCAP_CAPTURE
+  #include <helpers/PcapCapture.h>
+  #define PCAP_CAPTURE_FILE  "/capture.pcapng"
+#endif
 
 class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   FILESYSTEM* _fs;
@@ -91,6 +96,14 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   uint64_t uptime_millis;
   unsigned long next_local_advert, next_flood_advert;
   bool _logging;
+  PacketLog packet_log;
+#ifdef WITH_PCAP_CAPTURE
+  PcapCapture pcap;
+ #ifndef PCAP_CAPTURE_STREAM
+  File pcap_file;
+  unsigned long next_pcap_flush;
+ #endif
+#endif
   NodePrefs _prefs;
   ClientACL  acl;
   CommonCLI _cli;
@@ -102,11 +115,19 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   RegionEntry* load_stack[8];
   RegionEntry* recv_pkt_region;
   RateLimiter discover_limiter, anon_limiter;
+  SourceRateLimiter flood_src_limiter;
+  GossipPolicy gossip;
+  bool recv_pkt_deferred;
   bool region_load_active;
   unsigned long dirty_contacts_expiry;
 #if MAX_NEIGHBOURS
   NeighbourInfo neighbours[MAX_NEIGHBOURS];
+  NeighbourTable neighbour_table;
 #endif
+  ContentionWindow tx_window;
+  unsigned long next_tx_window_update;
+  StatsHistory stats_history;
+  unsigned long next_stats_minute;
   CayenneLPP telemetry;
   unsigned long set_radio_at, revert_radio_at;
   float pending_freq;
@@ -122,7 +143,10 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   MQTTBridge bridge;
 #endif
 
-  void putNeighbour(const mesh::Identity& id, uint32_t timestamp, float snr);
+  void putNeighbour(const mesh::Identity& id, uint32_t timestamp, float snr, float rssi);
+  uint32_t getFloodSourceKey(const mesh::Packet* packet) const;
+  void cancelQueuedFlood(const mesh::Packet* queued, const mesh::Packet* heard);
+  void getStatsTotals(StatsTotals& totals);
   uint8_t handleLoginReq(const mesh::Identity& sender, const uint8_t* secret, uint32_t sender_timestamp, const uint8_t* data, bool is_flood);
   uint8_t handleAnonRegionsReq(const mesh::Identity& sender, uint32_t sender_timestamp, const uint8_t* data);
   uint8_t handleAnonOwnerReq(const mesh::Identity& sender, uint32_t sender_timestamp, const uint8_t* data);
@@ -130,8 +154,6 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   int handleRequest(ClientInfo* sender, uint32_t sender_timestamp, uint8_t* payload, size_t payload_len);
   mesh::Packet* createSelfAdvert();
 
-  File openAppend(const char* fname);
-
 protected:
   float getAirtimeBudgetFactor() const override {
     return _prefs.airtime_factor;
@@ -198,13 +220,30 @@ public:
   void updateAdvertTimer() override;
   void updateFloodAdvertTimer() override;
 
-  void setLoggingOn(bool enable) override { _logging = enable; }
+  void setLoggingOn(bool enable) override {
+    if (!enable) packet_log.flush();
+    _logging = enable;
+#ifdef WITH_PCAP_CAPTURE
+    setCaptureOn(enable);
+#endif
+  }
 
   void eraseLogFile() override {
-    _fs->remove(PACKET_LOG_FILE);
+    packet_log.erase();
+    _fs->remove(LEGACY_PACKET_LOG_FILE);
+#ifdef WITH_PCAP_CAPTURE
+    setCaptureOn(false);
+    _fs->remove(PCAP_CAPTURE_FILE);
+    setCaptureOn(_logging);
+#endif
   }
 
   void dumpLogFile() override;
+#ifdef WITH_PCAP_CAPTURE
+  void setCaptureOn(bool enable);
+  void captureFrame(float snr, float rssi, const uint8_t raw[], int len, bool is_tx);
+  void dumpCaptureFile() override;
+#endif
   void setTxPower(int8_t power_dbm) override;
   void formatNeighborsReply(char *reply) override;
   void removeNeighbor(const uint8_t* pubkey, int key_len) override;
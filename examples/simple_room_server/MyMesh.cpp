@@ -10,6 +10,13 @@
 
 #define POST_SYNC_DELAY_SECS        6
 
+#ifndef MAX_PUSHES_IN_FLIGHT
+  #define MAX_PUSHES_IN_FLIGHT      8     // max posts awaiting a push ACK, at once (across all clients)
+#endif
+#define MAX_PUSH_QUEUE_DEPTH        2     // don't push while this many packets are already queued for TX
+#define PUSH_FLOOD_PATH_COST        8     // as if this many hops, for prioritising
+#define MAX_BUNDLE_DATA_LEN         (MAX_PACKET_PAYLOAD - CIPHER_MAC_SIZE - CIPHER_BLOCK_SIZE + 1)   // see createDatagram()
+
 #define FIRMWARE_VER_LEVEL       1
 
 #define REQ_TYPE_GET_STATUS         0x01 // same as _GET_STATS
@@ -40,73 +47,343 @@ struct ServerStats {
 
 void MyMesh::addPost(ClientInfo *client, const char *postData) {
   // TODO: suggested postData format: <title>/<descrption>
-  posts[next_post_idx].author = client->id; // add to cyclic queue
-  StrHelper::strncpy(posts[next_post_idx].text, postData, MAX_POST_TEXT_LEN);
+  uint32_t timestamp = getRTCClock()->getCurrentTimeUnique();
+  if (next_post_seq > getOldestCachedSeq()) {   // keep timestamps increasing with seq, even if RTC went backwards
+    uint32_t prev = posts[(next_post_seq - 1) % MAX_UNSYNCED_POSTS].post_timestamp;
+    if (timestamp <= prev) timestamp = prev + 1;
+  }
 
-  posts[next_post_idx].post_timestamp = getRTCClock()->getCurrentTimeUnique();
-  next_post_idx = (next_post_idx + 1) % MAX_UNSYNCED_POSTS;
+  auto& post = posts[next_post_seq % MAX_UNSYNCED_POSTS]; // add to cyclic queue (replaces oldest)
+  post.author = client->id;
+  StrHelper::strncpy(post.text, postData, MAX_POST_TEXT_LEN);
+  post.post_timestamp = timestamp;
+
+  archive.removeExpired(timestamp);
+  if (!archive.append(next_post_seq, post)) {
+    MESH_DEBUG_PRINTLN("addPost: unable to archive post");
+  }
+  next_post_seq++;
 
+#ifdef WITH_ROOM_GROUP_KEY
+  broadcastPost(next_post_seq - 1);
+#endif
   next_push = futureMillis(PUSH_NOTIFY_DELAY_MILLIS);
   _num_posted++; // stats
 }
 
-void MyMesh::pushPostToClient(ClientInfo *client, PostInfo &post) {
-  int len = 0;
-  memcpy(&reply_data[len], &post.post_timestamp, 4);
-  len += 4; // this is a PAST timestamp... but should be accepted by client
+#ifdef WITH_ROOM_GROUP_KEY
+void MyMesh::rotateGroupKey() {
+  memset(group_channel.secret, 0, sizeof(group_channel.secret));
+  getRNG()->random(group_channel.secret, CIPHER_KEY_SIZE);
+  mesh::Utils::sha256(group_channel.hash, sizeof(group_channel.hash), group_channel.secret, CIPHER_KEY_SIZE);
+  if (++group_key_id == 0) group_key_id = 1;
+  group_key_expiry = getRTCClock()->getCurrentTime() + ROOM_GROUP_KEY_ROTATE_SECS;
+  // NOTE: clients get the new key with their next KEEP_ALIVE, and are pushed to direct until then
+}
 
-  uint8_t attempt;
-  getRNG()->random(&attempt, 1); // need this for re-tries, so packet hash (and ACK) will be different
-  reply_data[len++] = (TXT_TYPE_SIGNED_PLAIN << 2) | (attempt & 3); // 'signed' plain text
+void MyMesh::sendGroupKey(ClientInfo *client) {
+  uint8_t data[4 + 1 + 1 + CIPHER_KEY_SIZE];
+  uint32_t now = getRTCClock()->getCurrentTimeUnique();
+  memcpy(data, &now, 4);
+  data[4] = (TXT_TYPE_ROOM_KEY << 2);   // NOTE: no ACK, client confirms key_id in its next KEEP_ALIVE
+  data[5] = group_key_id;
+  memcpy(&data[6], group_channel.secret, CIPHER_KEY_SIZE);
 
-  // encode prefix of post.author.pub_key
-  memcpy(&reply_data[len], post.author.pub_key, 4);
-  len += 4; // just first 4 bytes
+  auto pkt = createDatagram(PAYLOAD_TYPE_TXT_MSG, client->id, client->shared_secret, data, sizeof(data));
+  if (pkt) {
+    sendDirect(pkt, client->out_path, client->out_path_len, SERVER_RESPONSE_DELAY * 2);   // after the ACK
+  }
+}
+
+void MyMesh::broadcastPost(uint32_t seq) {
+  int holders = 0;
+  bool all_neighbours = true;
+  for (int i = 0; i < acl.getNumClients(); i++) {
+    auto c = acl.getClientByIdx(i);
+    if (c->last_activity == 0 || getRoomState(c)->group_key_id != group_key_id) continue;
+    holders++;
+    if (c->out_path_len != 0) all_neighbours = false;
+  }
+  if (holders < ROOM_GROUP_PUSH_MIN_CLIENTS) return;   // direct pushes will be more reliable
 
+  const PostInfo& post = posts[seq % MAX_UNSYNCED_POSTS];
+  uint32_t prev_timestamp = 0;   // lets clients detect a gap (then they don't advance their sync_since)
+  if (seq > getOldestCachedSeq()) prev_timestamp = posts[(seq - 1) % MAX_UNSYNCED_POSTS].post_timestamp;
+
+  uint8_t data[13 + MAX_POST_TEXT_LEN];
+  memcpy(data, &post.post_timestamp, 4);
+  data[4] = (TXT_TYPE_SIGNED_PLAIN << 2);
+  memcpy(&data[5], &prev_timestamp, 4);
+  memcpy(&data[9], post.author.pub_key, 4);
   int text_len = strlen(post.text);
-  memcpy(&reply_data[len], post.text, text_len);
-  len += text_len;
+  memcpy(&data[13], post.text, text_len);
+
+  auto pkt = createGroupDatagram(PAYLOAD_TYPE_GRP_DATA, group_channel, data, 13 + text_len);
+  if (pkt == NULL) return;
+  if (all_neighbours) {
+    sendZeroHop(pkt);
+  } else {
+    sendFlood(pkt);
+  }
+  _num_post_pushes++; // stats
+
+  // assume holders that were up to date got it. Any that missed it will say so in their next KEEP_ALIVE,
+  // (via their sync_since), and then be caught up with direct pushes
+  for (int i = 0; i < acl.getNumClients(); i++) {
+    auto c = acl.getClientByIdx(i);
+    if (c->last_activity == 0 || getRoomState(c)->group_key_id != group_key_id) continue;
+    if (countInFlight(c) == 0 && findPushSlot(c, true) == NULL && advanceSyncCursor(c) == seq) {
+      c->extra.room.sync_seq = seq + 1;
+      c->extra.room.sync_since = post.post_timestamp;
+    }
+  }
+}
+#endif
+
+const PostInfo* MyMesh::getPost(uint32_t seq) {
+  if (seq >= getOldestCachedSeq() && seq < next_post_seq) {
+    return &posts[seq % MAX_UNSYNCED_POSTS];
+  }
+  return archive.read(seq, archived_post) ? &archived_post : NULL;
+}
+
+int MyMesh::encodePostBundle(ClientInfo *client, RoomPushSlot& slot, uint32_t now) {
+  // re-send same posts, OR as many as are ready and will fit
+  uint32_t end = slot.span ? slot.seq + slot.span : next_post_seq;
+  int len = 6;   // timestamp, flags, count
+  int count = 0;
+  uint32_t last_timestamp = 0;
+  uint32_t seq = slot.seq;
+  for (; seq < end; seq++) {
+    const PostInfo* p = getPost(seq);
+    if (p == NULL) break;
+    if (p->author.matches(client->id)) continue;   // don't push posts to the author
+    if (slot.span == 0 && now < p->post_timestamp + POST_SYNC_DELAY_SECS) break;   // too new
+
+    int text_len = strlen(p->text);
+    if (len + 9 + text_len > MAX_BUNDLE_DATA_LEN || count >= 255) break;
+
+    memcpy(&reply_data[len], &p->post_timestamp, 4);
+    memcpy(&reply_data[len + 4], p->author.pub_key, 4);   // just first 4 bytes
+    reply_data[len + 8] = text_len;
+    memcpy(&reply_data[len + 9], p->text, text_len);
+    len += 9 + text_len;
+    last_timestamp = p->post_timestamp;
+    count++;
+  }
+  if (count < 2) return 0;   // not worth it, send as single post
+
+  uint8_t attempt;
+  getRNG()->random(&attempt, 1);
+  memcpy(reply_data, &last_timestamp, 4);
+  reply_data[4] = (TXT_TYPE_SIGNED_BUNDLE << 2) | (attempt & 3);
+  reply_data[5] = count;
+
+  slot.span = seq - slot.seq;
+  slot.post_timestamp = last_timestamp;
+  return len;
+}
+
+bool MyMesh::pushPostToClient(ClientInfo *client, RoomPushSlot& slot, uint32_t now) {
+  const PostInfo* p = getPost(slot.seq);
+  if (p == NULL) {
+    memset(&slot, 0, sizeof(slot));   // no longer available
+    return false;
+  }
+
+  int len = 0;
+  if (getRoomState(client)->push_caps & LOGIN_CAP_SIGNED_BUNDLE) {
+    len = encodePostBundle(client, slot, now);
+    if (len == 0) p = getPost(slot.seq);   // archived_post may have been overwritten
+  }
+  if (len == 0) {
+    const PostInfo& post = *p;
+    memcpy(&reply_data[len], &post.post_timestamp, 4);
+    len += 4; // this is a PAST timestamp... but should be accepted by client
+
+    uint8_t attempt;
+    getRNG()->random(&attempt, 1); // need this for re-tries, so packet hash (and ACK) will be different
+    reply_data[len++] = (TXT_TYPE_SIGNED_PLAIN << 2) | (attempt & 3); // 'signed' plain text
+
+    // encode prefix of post.author.pub_key
+    memcpy(&reply_data[len], post.author.pub_key, 4);
+    len += 4; // just first 4 bytes
+
+    int text_len = strlen(post.text);
+    memcpy(&reply_data[len], post.text, text_len);
+    len += text_len;
+
+    slot.span = 1;
+    slot.post_timestamp = post.post_timestamp;
+  }
 
   // calc expected ACK reply
-  mesh::Utils::sha256((uint8_t *)&client->extra.room.pending_ack, 4, reply_data, len, client->id.pub_key, PUB_KEY_SIZE);
-  client->extra.room.push_post_timestamp = post.post_timestamp;
+  mesh::Utils::sha256((uint8_t *)&slot.expected_ack, 4, reply_data, len, client->id.pub_key, PUB_KEY_SIZE);
 
   auto reply = createDatagram(PAYLOAD_TYPE_TXT_MSG, client->id, client->shared_secret, reply_data, len);
   if (reply) {
     if (client->out_path_len < 0) {
       sendFlood(reply);
-      client->extra.room.ack_timeout = futureMillis(PUSH_ACK_TIMEOUT_FLOOD);
+      slot.ack_timeout = futureMillis(PUSH_ACK_TIMEOUT_FLOOD);
     } else {
       sendDirect(reply, client->out_path, client->out_path_len);
-      client->extra.room.ack_timeout =
-          futureMillis(PUSH_TIMEOUT_BASE + PUSH_ACK_TIMEOUT_FACTOR * (client->out_path_len + 1));
+      slot.ack_timeout = futureMillis(PUSH_TIMEOUT_BASE + PUSH_ACK_TIMEOUT_FACTOR * (client->out_path_len + 1));
     }
     _num_post_pushes++; // stats
-  } else {
-    client->extra.room.pending_ack = 0;
-    MESH_DEBUG_PRINTLN("Unable to push post to client");
+    return true;
   }
+  slot.expected_ack = 0;   // try again later
+  MESH_DEBUG_PRINTLN("Unable to push post to client");
+  return false;
+}
+
+uint32_t MyMesh::findPostSeqAfter(uint32_t timestamp) {
+  // post timestamps are unique, and increasing with seq, so binary search
+  uint32_t lo = getOldestCachedSeq(), hi = next_post_seq;
+  if (lo < hi && posts[lo % MAX_UNSYNCED_POSTS].post_timestamp > timestamp && archive.getOldestSeq() < lo) {
+    return archive.findSeqAfter(timestamp);   // older than cache, so seek in archive
+  }
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (posts[mid % MAX_UNSYNCED_POSTS].post_timestamp > timestamp) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  return lo;   // first post newer than timestamp, or next_post_seq if none
+}
+
+uint32_t MyMesh::advanceSyncCursor(ClientInfo *client) {
+  uint32_t seq = client->extra.room.sync_seq;
+  if (seq == 0) {   // sync_since was (re)set, eg. by login
+    seq = findPostSeqAfter(client->extra.room.sync_since);
+  }
+  uint32_t oldest = getOldestPostSeq();
+  if (seq < oldest) seq = oldest;   // missed posts have since been replaced in the queue
+
+  while (seq < next_post_seq) {
+    const PostInfo* p = getPost(seq);
+    if (p && !p->author.matches(client->id)) break;
+    seq++;   // don't push posts to the author (or unreadable)
+  }
+  client->extra.room.sync_seq = seq;
+  return seq;
 }
 
 uint8_t MyMesh::getUnsyncedCount(ClientInfo *client) {
-  uint8_t count = 0;
-  for (int k = 0; k < MAX_UNSYNCED_POSTS; k++) {
-    if (posts[k].post_timestamp > client->extra.room.sync_since // is new post for this Client?
-        && !posts[k].author.matches(client->id)) {   // don't push posts to the author
-      count++;
+  uint32_t seq = advanceSyncCursor(client);
+  uint32_t cached = getOldestCachedSeq();
+  uint32_t count = 0;
+  if (seq < cached) {   // NOTE: archived posts are counted without checking author, to avoid reading them all
+    count = cached - seq;
+    seq = cached;
+  }
+  for (; seq < next_post_seq && count < 255; seq++) {
+    if (!posts[seq % MAX_UNSYNCED_POSTS].author.matches(client->id)) count++;
+  }
+  return count < 255 ? count : 255;
+}
+
+RoomClientState* MyMesh::getRoomState(const ClientInfo *client) {
+  // NOTE: acl can evict, or shift clients down when one is removed, so check the state is still this client's
+  auto st = &room_state[client - acl.getClientByIdx(0)];
+  if (memcmp(st->key_prefix, client->id.pub_key, sizeof(st->key_prefix)) != 0) {
+    memset(st, 0, sizeof(*st));   // push resumes from client's cursor
+    memcpy(st->key_prefix, client->id.pub_key, sizeof(st->key_prefix));
+  }
+  return st;
+}
+
+void MyMesh::resetPushWindow(ClientInfo *client) {
+  auto st = getRoomState(client);
+  memset(st->window, 0, sizeof(st->window));
+}
+
+void MyMesh::resetPushRetries(ClientInfo *client) {   // client is active, so give posts in window fresh retries
+  auto st = getRoomState(client);
+  for (int j = 0; j < ROOM_PUSH_WINDOW; j++) {
+    st->window[j].retries = 0;
+  }
+  st->push_failures = 0;
+}
+
+int MyMesh::countInFlight(const ClientInfo *client) {
+  auto st = getRoomState(client);
+  int n = 0;
+  for (int j = 0; j < ROOM_PUSH_WINDOW; j++) {
+    if (st->window[j].expected_ack) n++;
+  }
+  return n;
+}
+
+RoomPushSlot* MyMesh::findPushSlot(ClientInfo *client, bool for_resend) {
+  auto st = getRoomState(client);
+  for (int j = 0; j < ROOM_PUSH_WINDOW; j++) {
+    auto s = &st->window[j];
+    if (for_resend ? (s->seq && !s->acked && s->expected_ack == 0) : s->seq == 0) return s;
+  }
+  return NULL;
+}
+
+uint32_t MyMesh::getNextSendSeq(ClientInfo *client) {
+  uint32_t seq = advanceSyncCursor(client);
+  auto st = getRoomState(client);
+  for (int j = 0; j < ROOM_PUSH_WINDOW; j++) {   // after any already in window
+    auto s = &st->window[j];
+    uint32_t end = s->seq + (s->span ? s->span : 1);
+    if (s->seq && end > seq) seq = end;
+  }
+  while (seq < next_post_seq) {
+    const PostInfo* p = getPost(seq);
+    if (p && !p->author.matches(client->id)) break;
+    seq++;   // don't push posts to the author (or unreadable)
+  }
+  return seq;
+}
+
+void MyMesh::advanceWindow(ClientInfo *client) {
+  for (;;) {
+    uint32_t base = advanceSyncCursor(client);
+    RoomPushSlot* found = NULL;
+    auto st = getRoomState(client);
+    for (int j = 0; j < ROOM_PUSH_WINDOW; j++) {
+      auto s = &st->window[j];
+      if (s->seq && s->seq < base) {
+        memset(s, 0, sizeof(*s));   // stale, post no longer available
+      } else if (s->seq == base) {
+        found = s;
+      }
     }
+    if (found == NULL || !found->acked) break;
+
+    // oldest in window is ACKed, so can advance Client's SINCE timestamp
+    client->extra.room.sync_since = found->post_timestamp;
+    client->extra.room.sync_seq = base + (found->span ? found->span : 1);
+    memset(found, 0, sizeof(*found));
   }
-  return count;
 }
 
 bool MyMesh::processAck(const uint8_t *data) {
   for (int i = 0; i < acl.getNumClients(); i++) {
     auto client = acl.getClientByIdx(i);
-    if (client->extra.room.pending_ack && memcmp(data, &client->extra.room.pending_ack, 4) == 0) { // got an ACK from Client!
-      client->extra.room.pending_ack = 0; // clear this, so next push can happen
-      client->extra.room.push_failures = 0;
-      client->extra.room.sync_since = client->extra.room.push_post_timestamp; // advance Client's SINCE timestamp, to sync next post
-      return true;
+    auto st = getRoomState(client);
+    for (int j = 0; j < ROOM_PUSH_WINDOW; j++) {
+      auto s = &st->window[j];
+      if (s->seq == 0 || s->acked) continue;
+
+      if ((s->expected_ack && memcmp(data, &s->expected_ack, 4) == 0) ||
+          (s->prev_ack && memcmp(data, &s->prev_ack, 4) == 0)) {   // got an ACK from Client! (possibly late)
+        s->acked = true;
+        s->expected_ack = s->prev_ack = 0;
+        st->push_failures = 0;   // client is reachable, re-count from posts still not ACKed
+        for (int k = 0; k < ROOM_PUSH_WINDOW; k++) {
+          auto o = &st->window[k];
+          if (o->seq && !o->acked && o->retries > st->push_failures) st->push_failures = o->retries;
+        }
+        advanceWindow(client);
+        return true;
+      }
     }
   }
   return false;
@@ -119,16 +396,6 @@ mesh::Packet *MyMesh::createSelfAdvert() {
   return createAdvert(self_id, app_data, app_data_len);
 }
 
-File MyMesh::openAppend(const char *fname) {
-#if defined(NRF52_PLATFORM)
-  return _fs->open(fname, FILE_O_WRITE);
-#elif defined(RP2040_PLATFORM)
-  return _fs->open(fname, "a");
-#else
-  return _fs->open(fname, "a", true);
-#endif
-}
-
 int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t *payload,
                           size_t payload_len) {
   // uint32_t now = getRTCClock()->getCurrentTimeUnique();
@@ -202,50 +469,18 @@ void MyMesh::logRxRaw(float snr, float rssi, const uint8_t raw[], int len) {
 
 void MyMesh::logRx(mesh::Packet *pkt, int len, float score) {
   if (_logging) {
-    File f = openAppend(PACKET_LOG_FILE);
-    if (f) {
-      f.print(getLogDateTime());
-      f.printf(": RX, len=%d (type=%d, route=%s, payload_len=%d) SNR=%d RSSI=%d score=%d", len,
-               pkt->getPayloadType(), pkt->isRouteDirect() ? "D" : "F", pkt->payload_len,
-               (int)_radio->getLastSNR(), (int)_radio->getLastRSSI(), (int)(score * 1000));
-
-      if (pkt->getPayloadType() == PAYLOAD_TYPE_PATH || pkt->getPayloadType() == PAYLOAD_TYPE_REQ ||
-          pkt->getPayloadType() == PAYLOAD_TYPE_RESPONSE || pkt->getPayloadType() == PAYLOAD_TYPE_TXT_MSG) {
-        f.printf(" [%02X -> %02X]\n", (uint32_t)pkt->payload[1], (uint32_t)pkt->payload[0]);
-      } else {
-        f.printf("\n");
-      }
-      f.close();
-    }
+    packet_log.add(PKT_LOG_RX, getRTCClock()->getCurrentTime(), _ms->getMillis(), pkt, len,
+                   _radio->getLastSNR(), _radio->getLastRSSI(), score);
   }
 }
 void MyMesh::logTx(mesh::Packet *pkt, int len) {
   if (_logging) {
-    File f = openAppend(PACKET_LOG_FILE);
-    if (f) {
-      f.print(getLogDateTime());
-      f.printf(": TX, len=%d (type=%d, route=%s, payload_len=%d)", len, pkt->getPayloadType(),
-               pkt->isRouteDirect() ? "D" : "F", pkt->payload_len);
-
-      if (pkt->getPayloadType() == PAYLOAD_TYPE_PATH || pkt->getPayloadType() == PAYLOAD_TYPE_REQ ||
-          pkt->getPayloadType() == PAYLOAD_TYPE_RESPONSE || pkt->getPayloadType() == PAYLOAD_TYPE_TXT_MSG) {
-        f.printf(" [%02X -> %02X]\n", (uint32_t)pkt->payload[1], (uint32_t)pkt->payload[0]);
-      } else {
-        f.printf("\n");
-      }
-      f.close();
-    }
+    packet_log.add(PKT_LOG_TX, getRTCClock()->getCurrentTime(), _ms->getMillis(), pkt, len);
   }
 }
 void MyMesh::logTxFail(mesh::Packet *pkt, int len) {
   if (_logging) {
-    File f = openAppend(PACKET_LOG_FILE);
-    if (f) {
-      f.print(getLogDateTime());
-      f.printf(": TX FAIL!, len=%d (type=%d, route=%s, payload_len=%d)\n", len, pkt->getPayloadType(),
-               pkt->isRouteDirect() ? "D" : "F", pkt->payload_len);
-      f.close();
-    }
+    packet_log.add(PKT_LOG_TX_FAIL, getRTCClock()->getCurrentTime(), _ms->getMillis(), pkt, len);
   }
 }
 
@@ -288,6 +523,10 @@ void MyMesh::onAnonDataRecv(mesh::Packet *packet, const uint8_t *secret, const m
 
     data[len] = 0;                                        // ensure null terminator
 
+    // newer clients append capability flags, after password's null terminator
+    size_t caps_idx = 8 + strlen((char *)&data[8]) + 1;
+    uint8_t caps = caps_idx < len ? data[caps_idx] : 0;
+
     ClientInfo* client = NULL;
     if (data[8] == 0) {   // blank password, just check if sender is in ACL
       client = acl.getClient(sender.pub_key, PUB_KEY_SIZE);
@@ -321,8 +560,10 @@ void MyMesh::onAnonDataRecv(mesh::Packet *packet, const uint8_t *secret, const m
       MESH_DEBUG_PRINTLN("Login success!");
       client->last_timestamp = sender_timestamp;
       client->extra.room.sync_since = sender_sync_since;
-      client->extra.room.pending_ack = 0;
-      client->extra.room.push_failures = 0;
+      client->extra.room.sync_seq = 0;   // find cursor lazily
+      resetPushWindow(client);
+      getRoomState(client)->push_failures = 0;
+      getRoomState(client)->group_key_id = 0;
 
       client->last_activity = getRTCClock()->getCurrentTime();
       client->permissions &= ~0x03;
@@ -332,6 +573,8 @@ void MyMesh::onAnonDataRecv(mesh::Packet *packet, const uint8_t *secret, const m
       dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
     }
 
+    getRoomState(client)->push_caps = caps;
+
     if (packet->isRouteFlood()) {
       client->out_path_len = -1;  // need to rediscover out_path
     }
@@ -408,7 +651,7 @@ void MyMesh::onPeerDataRecv(mesh::Packet *packet, uint8_t type, int sender_idx,
 
       uint32_t now = getRTCClock()->getCurrentTimeUnique();
       client->last_activity = now;
-      client->extra.room.push_failures = 0; // reset so push can resume (if prev failed)
+      resetPushRetries(client);   // so push can resume (if prev failed)
 
       // len can be > original length, but 'text' will be padded with zeroes
       data[len] = 0; // need to make a C string again, with null terminator
@@ -502,7 +745,7 @@ void MyMesh::onPeerDataRecv(mesh::Packet *packet, uint8_t type, int sender_idx,
 
       uint32_t now = getRTCClock()->getCurrentTime();
       client->last_activity = now; // <-- THIS will keep client connection alive
-      client->extra.room.push_failures = 0;   // reset so push can resume (if prev failed)
+      resetPushRetries(client);   // so push can resume (if prev failed)
 
       if (data[4] == REQ_TYPE_KEEP_ALIVE && packet->isRouteDirect()) { // request type
         uint32_t forceSince = 0;
@@ -513,9 +756,20 @@ void MyMesh::onPeerDataRecv(mesh::Packet *packet, uint8_t type, int sender_idx,
         }
         if (forceSince > 0) {
           client->extra.room.sync_since = forceSince; // force-update the 'sync since'
+          client->extra.room.sync_seq = 0;
         }
 
-        client->extra.room.pending_ack = 0;
+        resetPushWindow(client);
+
+      #ifdef WITH_ROOM_GROUP_KEY
+        // newer clients follow with the id of room group key they hold (0 = none, or padding)
+        auto st = getRoomState(client);
+        st->group_key_id = (st->push_caps & LOGIN_CAP_ROOM_KEY) && len >= 10 ? data[9] : 0;
+        if ((st->push_caps & LOGIN_CAP_ROOM_KEY) && st->group_key_id != group_key_id
+            && client->out_path_len >= 0) {
+          sendGroupKey(client);
+        }
+      #endif
 
         // TODO: Throttle KEEP_ALIVE requests!
         // if client sends too quickly, evict()
@@ -587,13 +841,17 @@ void MyMesh::onAckRecv(mesh::Packet *packet, uint32_t ack_crc) {
 MyMesh::MyMesh(mesh::MainBoard &board, mesh::Radio &radio, mesh::MillisecondClock &ms, mesh::RNG &rng,
                mesh::RTCClock &rtc, mesh::MeshTables &tables)
     : mesh::Mesh(radio, ms, rng, rtc, *new StaticPoolPacketManager(32), tables),
-      _cli(board, rtc, sensors, acl, &_prefs, this), telemetry(MAX_PACKET_PAYLOAD - 4) {
+      packet_log(PACKET_LOG_FILE), _cli(board, rtc, sensors, acl, &_prefs, this), telemetry(MAX_PACKET_PAYLOAD - 4) {
   last_millis = 0;
   uptime_millis = 0;
   next_local_advert = next_flood_advert = 0;
   dirty_contacts_expiry = 0;
   _logging = false;
   set_radio_at = revert_radio_at = 0;
+#ifdef WITH_ROOM_GROUP_KEY
+  group_key_id = 0;
+  group_key_expiry = 0;
+#endif
 
   // defaults
   memset(&_prefs, 0, sizeof(_prefs));
@@ -624,8 +882,9 @@ MyMesh::MyMesh(mesh::MainBoard &board, mesh::Radio &radio, mesh::MillisecondCloc
   _prefs.gps_interval = 0;
   _prefs.advert_loc_policy = ADVERT_LOC_PREFS;
 
-  next_post_idx = 0;
+  next_post_seq = cache_start_seq = 1;
   next_client_idx = 0;
+  memset(room_state, 0, sizeof(room_state));
   next_push = 0;
   memset(posts, 0, sizeof(posts));
   _num_posted = _num_post_pushes = 0;
@@ -634,11 +893,23 @@ MyMesh::MyMesh(mesh::MainBoard &board, mesh::Radio &radio, mesh::MillisecondCloc
 void MyMesh::begin(FILESYSTEM *fs) {
   mesh::Mesh::begin();
   _fs = fs;
+  packet_log.begin(_fs);
   // load persisted prefs
   _cli.loadPrefs(_fs);
 
   acl.load(_fs, self_id);
 
+  // restore recent posts to cache
+  archive.begin(_fs);
+  next_post_seq = archive.getNextSeq();
+  cache_start_seq = archive.getOldestSeq();
+  for (uint32_t seq = getOldestCachedSeq(); seq < next_post_seq; seq++) {
+    if (!archive.read(seq, posts[seq % MAX_UNSYNCED_POSTS])) cache_start_seq = seq + 1;
+  }
+#ifdef WITH_ROOM_GROUP_KEY
+  rotateGroupKey();   // NOTE: not persisted, clients fetch a new one after reboot
+#endif
+
   radio_set_params(_prefs.freq, _prefs.bw, _prefs.sf, _prefs.cr);
   radio_set_tx_power(_prefs.tx_power_dbm);
 
@@ -704,19 +975,7 @@ void MyMesh::updateFloodAdvertTimer() {
 }
 
 void MyMesh::dumpLogFile() {
-#if defined(RP2040_PLATFORM)
-  File f = _fs->open(PACKET_LOG_FILE, "r");
-#else
-  File f = _fs->open(PACKET_LOG_FILE);
-#endif
-  if (f) {
-    while (f.available()) {
-      int c = f.read();
-      if (c < 0) break;
-      Serial.print((char)c);
-    }
-    f.close();
-  }
+  packet_log.dump(Serial);
 }
 
 void MyMesh::setTxPower(int8_t power_dbm) {
@@ -780,6 +1039,9 @@ void MyMesh::handleCommand(uint32_t sender_timestamp, char *command, char *reply
         uint8_t perms = atoi(sp);
         if (acl.applyPermissions(self_id, pubkey, hex_len / 2, perms)) {
           dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);   // trigger acl.save()
+        #ifdef WITH_ROOM_GROUP_KEY
+          rotateGroupKey();   // in case access was revoked
+        #endif
           strcpy(reply, "OK");
         } else {
           strcpy(reply, "Err - invalid params");
@@ -808,48 +1070,106 @@ bool MyMesh::saveFilter(ClientInfo* client) {
   return client->isAdmin();    // only save Admins
 }
 
+ClientInfo* MyMesh::selectPushClient(uint32_t now) {
+  ClientInfo* best = NULL;
+  uint32_t best_score = 0;
+  int best_idx = 0;
+  int n = acl.getNumClients();
+  for (int k = 0; k < n; k++) {
+    int i = (next_client_idx + k) % n;   // ties go to next in round-robin order
+    auto c = acl.getClientByIdx(i);
+    auto st = getRoomState(c);
+    if (c->last_activity == 0 || st->push_failures >= ROOM_PUSH_MAX_RETRIES) {
+      continue;   // evicted, OR retries max
+    }
+    uint32_t seq = c->extra.room.sync_seq;
+    if (seq == 0 || seq < getOldestPostSeq()) seq = advanceSyncCursor(c);
+
+    if (findPushSlot(c, true) == NULL) {   // nothing to re-send, so need room in window for a new post
+      if (findPushSlot(c, false) == NULL) continue;   // window full
+
+      uint32_t next = seq;   // NOTE: approximate, own posts are skipped when actually pushing
+      for (int j = 0; j < ROOM_PUSH_WINDOW; j++) {
+        auto s = &st->window[j];
+        uint32_t end = s->seq + (s->span ? s->span : 1);
+        if (s->seq && end > next) next = end;
+      }
+      if (next >= next_post_seq) continue;   // all synced, or in flight
+
+      if (next >= getOldestCachedSeq() && now < posts[next % MAX_UNSYNCED_POSTS].post_timestamp + POST_SYNC_DELAY_SECS) {
+        continue;   // next post is too new
+      }
+    }
+    if (seq >= next_post_seq) continue;
+
+    // prefer most backlog, and shortest path
+    uint32_t backlog = next_post_seq - seq;
+    int hops = c->out_path_len < 0 ? PUSH_FLOOD_PATH_COST : c->out_path_len;
+    uint32_t score = (backlog << 4) / (1 + hops);
+    if (best == NULL || score > best_score) {
+      best = c;
+      best_score = score;
+      best_idx = i;
+    }
+  }
+  if (best) next_client_idx = (best_idx + 1) % n;
+  return best;
+}
+
 void MyMesh::loop() {
   mesh::Mesh::loop();
 
   if (millisHasNowPassed(next_push) && acl.getNumClients() > 0) {
     // check for ACK timeouts
+    int in_flight = 0;
     for (int i = 0; i < acl.getNumClients(); i++) {
       auto c = acl.getClientByIdx(i);
-      if (c->extra.room.pending_ack && millisHasNowPassed(c->extra.room.ack_timeout)) {
-        c->extra.room.push_failures++;
-        c->extra.room.pending_ack = 0; // reset  (TODO: keep prev expected_ack's in a list, incase they arrive LATER, after we retry)
-        MESH_DEBUG_PRINTLN("pending ACK timed out: push_failures: %d", (uint32_t)c->extra.room.push_failures);
+      auto st = getRoomState(c);
+      for (int j = 0; j < ROOM_PUSH_WINDOW; j++) {
+        auto s = &st->window[j];
+        if (s->expected_ack && millisHasNowPassed(s->ack_timeout)) {
+          if (s->retries < 255) s->retries++;
+          if (s->retries > st->push_failures) st->push_failures = s->retries;
+          s->prev_ack = s->expected_ack;   // still accept this one, if it arrives LATER, after we retry
+          s->expected_ack = 0;             // just this post needs re-sending
+          MESH_DEBUG_PRINTLN("pending ACK timed out: seq %u, retries: %d", s->seq, (uint32_t)s->retries);
+        }
+      }
+      if (st->push_failures >= ROOM_PUSH_MAX_RETRIES) {
+        resetPushWindow(c);   // give up until Client is active again, then resume from its cursor
       }
+      in_flight += countInFlight(c);
     }
-    // check next Round-Robin client, and sync next new post
-    auto client = acl.getClientByIdx(next_client_idx);
+
+    // pipeline pushes to several clients at once, but only as fast as the radio is actually sending them
     bool did_push = false;
-    if (client->extra.room.pending_ack == 0 && client->last_activity != 0 &&
-        client->extra.room.push_failures < 3) { // not already waiting for ACK, AND not evicted, AND retries not max
-      MESH_DEBUG_PRINTLN("loop - checking for client %02X", (uint32_t)client->id.pub_key[0]);
+    if (in_flight < MAX_PUSHES_IN_FLIGHT && _mgr->getOutboundCount(0xFFFFFFFF) < MAX_PUSH_QUEUE_DEPTH
+        && isTxBudgetAvailable()) {
       uint32_t now = getRTCClock()->getCurrentTime();
-      for (int k = 0, idx = next_post_idx; k < MAX_UNSYNCED_POSTS; k++) {
-        auto p = &posts[idx];
-        if (now >= p->post_timestamp + POST_SYNC_DELAY_SECS &&
-            p->post_timestamp > client->extra.room.sync_since // is new post for this Client?
-            && !p->author.matches(client->id)) {   // don't push posts to the author
-          // push this post to Client, then wait for ACK
-          pushPostToClient(client, *p);
+      auto client = selectPushClient(now);
+      if (client) {
+        advanceWindow(client);   // drop any posts no longer available
+        RoomPushSlot* slot = findPushSlot(client, true);   // re-send timed out posts first
+        if (slot == NULL) {
+          uint32_t seq = getNextSendSeq(client);   // next new post for this Client
+          const PostInfo* p = seq < next_post_seq ? getPost(seq) : NULL;
+          if (p && now >= p->post_timestamp + POST_SYNC_DELAY_SECS && (slot = findPushSlot(client, false)) != NULL) {
+            slot->seq = seq;
+            slot->span = 0;   // as many as can be bundled
+            slot->prev_ack = 0;
+          }
+        }
+        if (slot && pushPostToClient(client, *slot, now)) {   // then wait for ACK, while pushing more
           did_push = true;
-          MESH_DEBUG_PRINTLN("loop - pushed to client %02X: %s", (uint32_t)client->id.pub_key[0], p->text);
-          break;
+          MESH_DEBUG_PRINTLN("loop - pushed seq %u (+%d) to client %02X (in flight: %d)", slot->seq, (int)slot->span - 1, (uint32_t)client->id.pub_key[0], in_flight + 1);
         }
-        idx = (idx + 1) % MAX_UNSYNCED_POSTS; // wrap to start of cyclic queue
       }
-    } else {
-      MESH_DEBUG_PRINTLN("loop - skipping busy (or evicted) client %02X", (uint32_t)client->id.pub_key[0]);
     }
-    next_client_idx = (next_client_idx + 1) % acl.getNumClients(); // round robin polling for each client
 
     if (did_push) {
-      next_push = futureMillis(SYNC_PUSH_INTERVAL);
+      next_push = futureMillis(SYNC_PUSH_INTERVAL / MAX_PUSHES_IN_FLIGHT);
     } else {
-      // were no unsynced posts for curr client, so proccess next client much quicker! (in next loop())
+      // nothing to push (or no capacity), check again soon
       next_push = futureMillis(SYNC_PUSH_INTERVAL / 8);
     }
   }
@@ -885,6 +1205,14 @@ void MyMesh::loop() {
     dirty_contacts_expiry = 0;
   }
 
+  packet_log.loop(_ms->getMillis());   // batched append of buffered log records
+
+#ifdef WITH_ROOM_GROUP_KEY
+  if (getRTCClock()->getCurrentTime() >= group_key_expiry) {
+    rotateGroupKey();
+  }
+#endif
+
   // TODO: periodically check for OLD/inactive entries in known_clients[], and evict
 
   // update uptime
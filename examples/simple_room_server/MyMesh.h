@@ -20,6 +20,8 @@
 #include <helpers/CommonCLI.h>
 #include <helpers/StatsFormatHelper.h>
 #include <helpers/ClientACL.h>
+#include "PostArchive.h"
+#include <helpers/PacketLog.h>
 #include <RTClib.h>
 #include <target.h>
 
@@ -67,6 +69,13 @@
   #define MAX_UNSYNCED_POSTS    32
 #endif
 
+#ifndef ROOM_PUSH_WINDOW
+  #define ROOM_PUSH_WINDOW      3    // max posts in flight to each room client
+#endif
+#ifndef ROOM_PUSH_MAX_RETRIES
+  #define ROOM_PUSH_MAX_RETRIES 3    // ACK timeouts for one post, before giving up on client
+#endif
+
 #ifndef SERVER_RESPONSE_DELAY
   #define SERVER_RESPONSE_DELAY   300
 #endif
@@ -75,16 +84,37 @@
   #define TXT_ACK_DELAY     200
 #endif
 
-#define FIRMWARE_ROLE "room_server"
+#ifdef WITH_ROOM_GROUP_KEY
+  #ifndef ROOM_GROUP_KEY_ROTATE_SECS
+    #define ROOM_GROUP_KEY_ROTATE_SECS   (24*60*60)
+  #endif
+  #ifndef ROOM_GROUP_PUSH_MIN_CLIENTS
+    #define ROOM_GROUP_PUSH_MIN_CLIENTS   2    // fewer than this, just push direct to each
+  #endif
+#endif
 
-#define PACKET_LOG_FILE  "/packet_log"
+#define FIRMWARE_ROLE "room_server"
 
-#define MAX_POST_TEXT_LEN    (160-9)
+#define PACKET_LOG_FILE  "/pkt_log"
+#define LEGACY_PACKET_LOG_FILE  "/packet_log"   // old text format
+
+struct RoomPushSlot {
+  uint32_t seq;              // of post, 0 = unused slot
+  uint32_t post_timestamp;
+  uint32_t expected_ack;     // 0 = needs (re)sending
+  uint32_t prev_ack;         // of previous attempt, in case it arrives late
+  unsigned long ack_timeout;
+  bool acked;                // waiting for earlier posts to be ACKed, before cursor can advance
+  uint8_t span;              // num posts covered from seq (if bundled), incl. any skipped
+  uint8_t retries;           // ACK timeouts so far, for this post
+};
 
-struct PostInfo {
-  mesh::Identity author;
-  uint32_t post_timestamp;   // by OUR clock
-  char text[MAX_POST_TEXT_LEN+1];
+struct RoomClientState {     // push state for each client, parallel to acl's clients[] (see getRoomState())
+  uint8_t  key_prefix[4];    // of client this state belongs to
+  RoomPushSlot window[ROOM_PUSH_WINDOW];
+  uint8_t  push_failures;    // most retries of any post in window
+  uint8_t  push_caps;        // LOGIN_CAP_*
+  uint8_t  group_key_id;     // of room group key client has confirmed holding, 0 = none
 };
 
 class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
@@ -93,6 +123,7 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   uint64_t uptime_millis;
   unsigned long next_local_advert, next_flood_advert;
   bool _logging;
+  PacketLog packet_log;
   NodePrefs _prefs;
   ClientACL acl;
   CommonCLI _cli;
@@ -100,9 +131,18 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   uint8_t reply_data[MAX_PACKET_PAYLOAD];
   unsigned long next_push;
   uint16_t _num_posted, _num_post_pushes;
-  int next_client_idx;  // for round-robin polling
-  int next_post_idx;
-  PostInfo posts[MAX_UNSYNCED_POSTS];   // cyclic queue
+  int next_client_idx;  // for round-robin tie-breaks
+  uint32_t next_post_seq;   // posts are numbered 1, 2, ... (by arrival)
+  uint32_t cache_start_seq;   // first seq ever held in posts[], since boot
+  PostInfo posts[MAX_UNSYNCED_POSTS];   // cyclic queue (cache of recent), post with seq N is at [N % MAX_UNSYNCED_POSTS]
+  PostArchive archive;        // all posts, persisted
+  PostInfo archived_post;     // last read from archive
+  RoomClientState room_state[MAX_CLIENTS];
+#ifdef WITH_ROOM_GROUP_KEY
+  mesh::GroupChannel group_channel;   // live posts are broadcast with this, to clients holding the key
+  uint8_t group_key_id;               // 1..255
+  uint32_t group_key_expiry;          // by OUR clock
+#endif
   CayenneLPP telemetry;
   unsigned long set_radio_at, revert_radio_at;
   float pending_freq;
@@ -112,11 +152,35 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   int  matching_peer_indexes[MAX_CLIENTS];
 
   void addPost(ClientInfo* client, const char* postData);
-  void pushPostToClient(ClientInfo* client, PostInfo& post);
+#ifdef WITH_ROOM_GROUP_KEY
+  void rotateGroupKey();
+  void sendGroupKey(ClientInfo* client);
+  void broadcastPost(uint32_t seq);
+#endif
+  int encodePostBundle(ClientInfo* client, RoomPushSlot& slot, uint32_t now);
+  bool pushPostToClient(ClientInfo* client, RoomPushSlot& slot, uint32_t now);
+  uint32_t getOldestCachedSeq() const {
+    uint32_t seq = next_post_seq > MAX_UNSYNCED_POSTS ? next_post_seq - MAX_UNSYNCED_POSTS : 1;
+    return seq < cache_start_seq ? cache_start_seq : seq;
+  }
+  uint32_t getOldestPostSeq() const {
+    uint32_t seq = archive.getOldestSeq();
+    return seq < getOldestCachedSeq() ? seq : getOldestCachedSeq();
+  }
+  const PostInfo* getPost(uint32_t seq);
+  uint32_t findPostSeqAfter(uint32_t timestamp);
+  RoomClientState* getRoomState(const ClientInfo* client);
+  uint32_t advanceSyncCursor(ClientInfo* client);
   uint8_t getUnsyncedCount(ClientInfo* client);
+  void resetPushWindow(ClientInfo* client);
+  void resetPushRetries(ClientInfo* client);
+  int countInFlight(const ClientInfo* client);
+  RoomPushSlot* findPushSlot(ClientInfo* client, bool for_resend);
+  uint32_t getNextSendSeq(ClientInfo* client);
+  void advanceWindow(ClientInfo* client);
+  ClientInfo* selectPushClient(uint32_t now);
   bool processAck(const uint8_t *data);
   mesh::Packet* createSelfAdvert();
-  File openAppend(const char* fname);
   int handleRequest(ClientInfo* sender, uint32_t sender_timestamp, uint8_t* payload, size_t payload_len);
 
 protected:
@@ -181,10 +245,14 @@ public:
   void updateAdvertTimer() override;
   void updateFloodAdvertTimer() override;
 
-  void setLoggingOn(bool enable) override { _logging = enable; }
+  void setLoggingOn(bool enable) override {
+    if (!enable) packet_log.flush();
+    _logging = enable;
+  }
 
   void eraseLogFile() override {
-    _fs->remove(PACKET_LOG_FILE);
+    packet_log.erase();
+    _fs->remove(LEGACY_PACKET_LOG_FILE);
   }
 
   void dumpLogFile() override;
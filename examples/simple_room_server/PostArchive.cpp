@@ -0,0 +1,281 @@
+#include "PostArchive.h"
+#include <helpers/RecordHelpers.h>
+
+#define POST_REC_SIZE   (40 + MAX_POST_TEXT_LEN + 1)   // seq, timestamp, author pub_key, text
+#define ARCHIVE_INDEX_FILE  "/posts_idx"   // just the oldest segno
+
+static File openRead(FILESYSTEM* _fs, const char* filename) {
+#if defined(RP2040_PLATFORM)
+  return _fs->open(filename, "r");
+#else
+  return _fs->open(filename);
+#endif
+}
+
+static File openWrite(FILESYSTEM* _fs, const char* filename) {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  _fs->remove(filename);
+  return _fs->open(filename, FILE_O_WRITE);
+#elif defined(RP2040_PLATFORM)
+  return _fs->open(filename, "w");
+#else
+  return _fs->open(filename, "w", true);
+#endif
+}
+
+static File openAppend(FILESYSTEM* _fs, const char* filename) {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  return _fs->open(filename, FILE_O_WRITE);
+#elif defined(RP2040_PLATFORM)
+  return _fs->open(filename, "a");
+#else
+  return _fs->open(filename, "a", true);
+#endif
+}
+
+void PostArchive::getSegmentPath(char* dest, uint32_t segno) const {
+  sprintf(dest, "/posts_%u", segno);
+}
+
+uint32_t PostArchive::getSegmentEnd(int i) const {   // seq after last in segment i
+  return i + 1 < _num_segs ? _segs[i + 1].segno * POST_ARCHIVE_SEG_RECS + 1 : _next_seq;
+}
+
+bool PostArchive::readRecord(File& file, uint32_t seq, uint32_t& timestamp, PostInfo* dest) {
+  uint8_t rec[POST_REC_SIZE];
+  int len = dest ? POST_REC_SIZE : 8;   // just the header, if only after timestamp
+
+  if (!file.seek(((seq - 1) % POST_ARCHIVE_SEG_RECS) * POST_REC_SIZE)) return false;
+  if (file.read(rec, len) != len || readLE32(&rec[0]) != seq) return false;
+
+  timestamp = readLE32(&rec[4]);
+  if (dest) {
+    dest->post_timestamp = timestamp;
+    dest->author = mesh::Identity(&rec[8]);
+    memcpy(dest->text, &rec[40], MAX_POST_TEXT_LEN + 1);
+    dest->text[MAX_POST_TEXT_LEN] = 0;
+  }
+  return true;
+}
+
+bool PostArchive::truncateSegment(uint32_t segno, int num_recs) {   // drop a torn tail, by re-writing the segment
+  char path[24], tmp_path[24];
+  getSegmentPath(path, segno);
+  sprintf(tmp_path, "/posts_%u.new", segno);
+
+  File src = openRead(_fs, path);
+  File dest = openWrite(_fs, tmp_path);
+  bool success = src && dest;
+  uint8_t rec[POST_REC_SIZE];
+  for (int i = 0; success && i < num_recs; i++) {
+    success = src.read(rec, POST_REC_SIZE) == POST_REC_SIZE && dest.write(rec, POST_REC_SIZE) == POST_REC_SIZE;
+  }
+  if (src) src.close();
+  if (dest) dest.close();
+
+  success = success && _fs->remove(path) && _fs->rename(tmp_path, path);
+  if (!success) _fs->remove(tmp_path);
+  return success;
+}
+
+void PostArchive::writeIndex(uint32_t oldest_segno) {
+  uint8_t buf[4];
+  writeLE32(buf, oldest_segno);
+  File file = openWrite(_fs, ARCHIVE_INDEX_FILE);
+  if (file) {
+    file.write(buf, 4);
+    file.close();
+  }
+}
+
+void PostArchive::begin(FILESYSTEM* fs) {
+  _fs = fs;
+  _num_segs = 0;
+  _next_seq = 1;
+  _failed = false;
+
+  uint32_t segno = 0;
+  if (_fs->exists(ARCHIVE_INDEX_FILE)) {
+    File file = openRead(_fs, ARCHIVE_INDEX_FILE);
+    if (file) {
+      uint8_t buf[4];
+      if (file.read(buf, 4) == 4) segno = readLE32(buf);
+      file.close();
+    }
+  }
+
+  uint32_t index_segno = segno;
+  char path[24];
+  if (segno > 0) {   // in case removeOldest() was interrupted
+    getSegmentPath(path, segno - 1);
+    _fs->remove(path);
+  }
+
+  // count the (consecutive) segments
+  int n = 0;
+  for (;;) {
+    getSegmentPath(path, segno + n);
+    if (!_fs->exists(path)) break;
+    n++;
+  }
+  while (n > 0) {
+    getSegmentPath(path, segno);
+    File file;
+    if (n > POST_ARCHIVE_MAX_SEGS || !(file = openRead(_fs, path))) {   // eg. POST_ARCHIVE_MAX_SEGS reduced
+      if (_num_segs == 0) _fs->remove(path);   // NOTE: can only remove from oldest end, else probing stops at gap
+      segno++;
+      n--;
+      continue;
+    }
+
+    uint32_t first_seq = segno * POST_ARCHIVE_SEG_RECS + 1;
+    uint32_t ts;
+    if (readRecord(file, first_seq, ts, NULL)) {
+      auto& seg = _segs[_num_segs++];
+      seg.segno = segno;
+      seg.first_timestamp = ts;
+
+      if (n == 1) {   // newest segment, determines next seq
+        int num_recs = file.size() / POST_REC_SIZE;
+        if (num_recs > POST_ARCHIVE_SEG_RECS) num_recs = POST_ARCHIVE_SEG_RECS;
+        while (num_recs > 1 && !readRecord(file, first_seq + num_recs - 1, ts, NULL)) num_recs--;
+
+        bool torn = file.size() != num_recs * POST_REC_SIZE;
+        file.close();
+        if (torn && !truncateSegment(segno, num_recs)) {
+          MESH_DEBUG_PRINTLN("PostArchive: unable to repair segment %u", segno);
+          _failed = true;   // no more appends, as they would be at wrong offsets
+        }
+        _next_seq = first_seq + num_recs;
+      } else {
+        file.close();
+      }
+    } else {
+      file.close();
+      if (n == 1) {   // was a torn first record
+        _fs->remove(path);
+        _next_seq = first_seq;
+      } else {
+        MESH_DEBUG_PRINTLN("PostArchive: corrupt segment %u", segno);
+        if (_num_segs == 0) _fs->remove(path);
+      }
+    }
+    segno++;
+    n--;
+  }
+  if (_num_segs == 0 && segno > 0) {
+    _next_seq = segno * POST_ARCHIVE_SEG_RECS + 1;
+  }
+  uint32_t oldest_segno = _num_segs > 0 ? _segs[0].segno : segno;
+  if (oldest_segno != index_segno) writeIndex(oldest_segno);
+}
+
+void PostArchive::removeOldest() {
+  if (_num_segs == 0) return;
+
+  writeIndex(_segs[0].segno + 1);   // first, so an interrupted removal is cleaned up by begin()
+
+  char path[24];
+  getSegmentPath(path, _segs[0].segno);
+  _fs->remove(path);
+
+  _num_segs--;
+  memmove(&_segs[0], &_segs[1], _num_segs * sizeof(_segs[0]));
+}
+
+void PostArchive::removeExpired(uint32_t now) {
+  // segment can be removed when its successor starts before the cut-off
+  uint32_t max_age = ((uint32_t)POST_ARCHIVE_MAX_AGE_DAYS) * 24 * 60 * 60;
+  while (_num_segs > 1 && _segs[1].first_timestamp + max_age < now) {
+    removeOldest();
+  }
+}
+
+bool PostArchive::append(uint32_t seq, const PostInfo& post) {
+  if (_fs == NULL || _failed || seq != _next_seq) return false;
+
+  uint32_t segno = (seq - 1) / POST_ARCHIVE_SEG_RECS;
+  bool new_seg = _num_segs == 0 || _segs[_num_segs - 1].segno != segno;
+  if (new_seg && _num_segs >= POST_ARCHIVE_MAX_SEGS) {
+    removeOldest();
+  }
+
+  uint8_t rec[POST_REC_SIZE];
+  writeLE32(&rec[0], seq);
+  writeLE32(&rec[4], post.post_timestamp);
+  memcpy(&rec[8], post.author.pub_key, PUB_KEY_SIZE);
+  memset(&rec[40], 0, MAX_POST_TEXT_LEN + 1);
+  strncpy((char *) &rec[40], post.text, MAX_POST_TEXT_LEN);
+
+  char path[24];
+  getSegmentPath(path, segno);
+  File file = openAppend(_fs, path);
+  if (!file) return false;
+
+  bool success = file.size() == ((seq - 1) % POST_ARCHIVE_SEG_RECS) * POST_REC_SIZE
+              && file.write(rec, POST_REC_SIZE) == POST_REC_SIZE;
+  file.close();
+  if (!success) {
+    MESH_DEBUG_PRINTLN("PostArchive: append failed, seq=%u", seq);
+    _failed = true;
+    return false;
+  }
+
+  if (new_seg) {
+    auto& seg = _segs[_num_segs++];
+    seg.segno = segno;
+    seg.first_timestamp = post.post_timestamp;
+  }
+  _next_seq++;
+  return true;
+}
+
+bool PostArchive::read(uint32_t seq, PostInfo& dest) {
+  if (_fs == NULL || seq < getOldestSeq() || seq >= _next_seq) return false;
+
+  char path[24];
+  getSegmentPath(path, (seq - 1) / POST_ARCHIVE_SEG_RECS);
+  File file = openRead(_fs, path);
+  if (!file) return false;
+
+  uint32_t ts;
+  bool success = readRecord(file, seq, ts, &dest);
+  file.close();
+  return success;
+}
+
+uint32_t PostArchive::findSeqAfter(uint32_t timestamp) {
+  if (_num_segs == 0 || timestamp < _segs[0].first_timestamp) return getOldestSeq();
+
+  // find last segment starting at/before timestamp
+  int lo = 0, hi = _num_segs - 1;
+  while (lo < hi) {
+    int mid = (lo + hi + 1) / 2;
+    if (_segs[mid].first_timestamp <= timestamp) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+
+  // then binary search within that segment
+  uint32_t first = _segs[lo].segno * POST_ARCHIVE_SEG_RECS + 2;   // first is known to be <= timestamp
+  uint32_t end = getSegmentEnd(lo);
+
+  char path[24];
+  getSegmentPath(path, _segs[lo].segno);
+  File file = openRead(_fs, path);
+  if (!file) return end;
+
+  while (first < end) {
+    uint32_t mid = first + (end - first) / 2;
+    uint32_t ts;
+    if (!readRecord(file, mid, ts, NULL) || ts > timestamp) {
+      end = mid;
+    } else {
+      first = mid + 1;
+    }
+  }
+  file.close();
+  return first;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <Arduino.h>   // needed for PlatformIO
+#include <Mesh.h>
+#include <helpers/IdentityStore.h>
+
+#define MAX_POST_TEXT_LEN    (160-9)
+
+struct PostInfo {
+  mesh::Identity author;
+  uint32_t post_timestamp;   // by OUR clock
+  char text[MAX_POST_TEXT_LEN+1];
+};
+
+#ifndef POST_ARCHIVE_SEG_RECS
+  #define POST_ARCHIVE_SEG_RECS    32     // posts per segment file
+#endif
+#ifndef POST_ARCHIVE_MAX_SEGS
+  #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+    #define POST_ARCHIVE_MAX_SEGS   2     // small internal flash
+  #else
+    #define POST_ARCHIVE_MAX_SEGS  16
+  #endif
+#endif
+#ifndef POST_ARCHIVE_MAX_AGE_DAYS
+  #define POST_ARCHIVE_MAX_AGE_DAYS  7
+#endif
+
+/**
+ * \brief  append-only archive of room posts, in fixed size segment files: "/posts_N" holds seqs
+ *         N*POST_ARCHIVE_SEG_RECS+1 onwards. Oldest segments are removed whole, when there are too many,
+ *         or all their posts are too old. A sparse (per segment) timestamp index is kept in RAM.
+ */
+class PostArchive {
+  struct SegmentInfo {
+    uint32_t segno;
+    uint32_t first_timestamp;
+  };
+
+  FILESYSTEM* _fs;
+  SegmentInfo _segs[POST_ARCHIVE_MAX_SEGS];   // oldest first
+  int _num_segs;
+  uint32_t _next_seq;
+  bool _failed;
+
+  void getSegmentPath(char* dest, uint32_t segno) const;
+  uint32_t getSegmentEnd(int i) const;
+  bool readRecord(File& file, uint32_t seq, uint32_t& timestamp, PostInfo* dest);
+  void writeIndex(uint32_t oldest_segno);
+  void removeOldest();
+  bool truncateSegment(uint32_t segno, int num_recs);
+
+public:
+  PostArchive() : _fs(NULL), _num_segs(0), _next_seq(1), _failed(false) { }
+
+  void begin(FILESYSTEM* fs);
+
+  /**
+   * \param  seq  must be getNextSeq()
+   */
+  bool append(uint32_t seq, const PostInfo& post);
+  bool read(uint32_t seq, PostInfo& dest);
+
+  /**
+   * \returns  seq of first archived post with timestamp AFTER given timestamp, or getNextSeq() if none.
+   */
+  uint32_t findSeqAfter(uint32_t timestamp);
+
+  void removeExpired(uint32_t now);
+
+  uint32_t getOldestSeq() const { return _num_segs > 0 ? _segs[0].segno * POST_ARCHIVE_SEG_RECS + 1 : _next_seq; }
+  uint32_t getNextSeq() const { return _next_seq; }
+};
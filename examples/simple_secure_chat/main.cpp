@@ -42,6 +42,10 @@
 
 #include <helpers/BaseChatMesh.h>
 
+#if CONTACT_CACHE_SIZE < MAX_CONTACTS
+  #error "contacts aren't paged to storage here, so CONTACT_CACHE_SIZE must be MAX_CONTACTS"
+#endif
+
 #define SEND_TIMEOUT_BASE_MILLIS          500
 #define FLOOD_SEND_TIMEOUT_FACTOR         16.0f
 #define DIRECT_SEND_PERHOP_FACTOR         6.0f
@@ -76,7 +80,8 @@ class MyMesh : public BaseChatMesh, ContactVisitor {
   uint32_t expected_ack_crc;
   ChannelDetails* _public;
   unsigned long last_msg_sent;
-  ContactInfo* curr_recipient;
+  uint8_t curr_recipient[PUB_KEY_SIZE];   // NOTE: not ContactInfo*, as that is only valid until the cache moves on
+  bool has_recipient;
   char command[512+10];
   uint8_t tmp_buf[256];
   char hex_buf[512];
@@ -157,6 +162,10 @@ class MyMesh : public BaseChatMesh, ContactVisitor {
     }
   }
 
+  ContactInfo* getCurrRecipient() {
+    return has_recipient ? lookupContactByPubKey(curr_recipient, PUB_KEY_SIZE) : NULL;
+  }
+
   void setClock(uint32_t timestamp) {
     uint32_t curr = getRTCClock()->getCurrentTime();
     if (timestamp > curr) {
@@ -286,7 +295,7 @@ public:
     _prefs.tx_power_dbm = LORA_TX_POWER;
 
     command[0] = 0;
-    curr_recipient = NULL;
+    has_recipient = false;
   }
 
   float getFreqPref() const { return _prefs.freq; }
@@ -384,11 +393,12 @@ public:
     while (*command == ' ') command++;  // skip leading spaces
 
     if (memcmp(command, "send ", 5) == 0) {
-      if (curr_recipient) {
+      ContactInfo* recipient = getCurrRecipient();
+      if (recipient) {
         const char *text = &command[5];
         uint32_t est_timeout;
 
-        int result = sendMessage(*curr_recipient, getRTCClock()->getCurrentTime(), 0, text, expected_ack_crc, est_timeout);
+        int result = sendMessage(*recipient, getRTCClock()->getCurrentTime(), 0, text, expected_ack_crc, est_timeout);
         if (result == MSG_SEND_FAILED) {
           Serial.println("   ERROR: unable to send.");
         } else {
@@ -429,15 +439,22 @@ public:
       uint32_t secs = _atoi(&command[5]);
       setClock(secs);
     } else if (memcmp(command, "to ", 3) == 0) {  // set current recipient
-      curr_recipient = searchContactsByPrefix(&command[3]);
-      if (curr_recipient) {
-        Serial.printf("   Recipient %s now selected.\n", curr_recipient->name);
+      ContactInfo* recipient = searchContactsByPrefix(&command[3]);
+      if (recipient) {
+        memcpy(curr_recipient, recipient->id.pub_key, PUB_KEY_SIZE);
+        has_recipient = true;
+        Serial.printf("   Recipient %s now selected.\n", recipient->name);
       } else {
         Serial.println("   Error: Name prefix not found.");
       }
+    } else if (memcmp(command, "find ", 5) == 0) {  // list all contacts matching name prefix
+      if (searchContactsByPrefix(&command[5], this) == 0) {
+        Serial.println("   Error: Name prefix not found.");
+      }
     } else if (strcmp(command, "to") == 0) {    // show current recipient
-      if (curr_recipient) {
-         Serial.printf("   Current: %s\n", curr_recipient->name);
+      ContactInfo* recipient = getCurrRecipient();
+      if (recipient) {
+         Serial.printf("   Current: %s\n", recipient->name);
       } else {
          Serial.println("   Err: no recipient selected");
       }
@@ -450,8 +467,9 @@ public:
         Serial.println("   ERR: unable to send");
       }
     } else if (strcmp(command, "reset path") == 0) {
-      if (curr_recipient) {
-        resetPathTo(*curr_recipient);
+      ContactInfo* recipient = getCurrRecipient();
+      if (recipient) {
+        resetPathTo(*recipient);
         saveContacts();
         Serial.println("   Done.");
       }
@@ -512,6 +530,7 @@ public:
       Serial.println("   list {n}");
       Serial.println("   to <recipient name or prefix>");
       Serial.println("   to");
+      Serial.println("   find <name prefix>");
       Serial.println("   send <text>");
       Serial.println("   advert");
       Serial.println("   reset path");
@@ -9,6 +9,8 @@
   #define TXT_ACK_DELAY     200
 #endif
 
+#define RECENT_UNLINKED    -2   // recent_prev[] marker, slot not (yet) in the recency list
+
 void BaseChatMesh::sendFloodScoped(const ContactInfo& recipient, mesh::Packet* pkt, uint32_t delay_millis) {
   sendFlood(pkt, delay_millis);
 }
@@ -56,10 +58,11 @@ void BaseChatMesh::sendAckTo(const ContactInfo& dest, uint32_t ack_hash) {
 }
 
 void BaseChatMesh::bootstrapRTCfromContacts() {
+  syncCachedEntries();
   uint32_t latest = 0;
   for (int i = 0; i < num_contacts; i++) {
-    if (contacts[i].lastmod > latest) {
-      latest = contacts[i].lastmod;
+    if (contact_index[i].lastmod > latest) {
+      latest = contact_index[i].lastmod;
     }
   }
   if (latest != 0) {
@@ -69,21 +72,37 @@ void BaseChatMesh::bootstrapRTCfromContacts() {
 
 ContactInfo* BaseChatMesh::allocateContactSlot() {
   if (num_contacts < MAX_CONTACTS) {
-    return &contacts[num_contacts++];
+    int slot = allocCacheSlot();
+    int idx = num_contacts++;
+    auto e = &contact_index[idx];
+    memset(e, 0, sizeof(*e));
+    e->rec_id = allocRecId();
+    e->cache_idx = slot;
+    cache_owner[slot] = idx;
+    cache_crc[slot] = 0;   // not saved yet
+    recent_prev[idx] = RECENT_UNLINKED;   // caller populates, then calls reindexContact()
+    secrets_pending = true;
+    return &contact_cache[slot];
   } else if (shouldOverwriteWhenFull()) {
+    syncCachedEntries();
     // Find oldest non-favourite contact by oldest lastmod timestamp
     int oldest_idx = -1;
     uint32_t oldest_lastmod = 0xFFFFFFFF;
     for (int i = 0; i < num_contacts; i++) {
-      bool is_favourite = (contacts[i].flags & 0x01) != 0;
-      if (!is_favourite && contacts[i].lastmod < oldest_lastmod) {
-        oldest_lastmod = contacts[i].lastmod;
+      bool is_favourite = (contact_index[i].flags & 0x01) != 0;
+      if (!is_favourite && contact_index[i].lastmod < oldest_lastmod) {
+        oldest_lastmod = contact_index[i].lastmod;
         oldest_idx = i;
       }
     }
-    if (oldest_idx >= 0) {
-      onContactOverwrite(contacts[oldest_idx].id.pub_key);
-      return &contacts[oldest_idx];
+    ContactInfo* c;
+    if (oldest_idx >= 0 && (c = fetchContact(oldest_idx)) != NULL) {
+      onContactOverwrite(c->id.pub_key);
+      unlinkRecent(oldest_idx);
+      removeNameOrder(oldest_idx);
+      cache_crc[contact_index[oldest_idx].cache_idx] = 0;   // record gets re-used for the new contact
+      secrets_pending = true;
+      return c;
     }
   }
   return NULL; // no space, no overwrite or all contacts are all favourites
@@ -111,14 +130,16 @@ void BaseChatMesh::onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id,
   }
 
   ContactInfo* from = NULL;
-  for (int i = 0; i < num_contacts; i++) {
-    if (id.matches(contacts[i].id)) {  // is from one of our contacts
-      from = &contacts[i];
-      if (timestamp <= from->last_advert_timestamp) {  // check for replay attacks!!
-        MESH_DEBUG_PRINTLN("onAdvertRecv: Possible replay attack, name: %s", from->name);
-        return;
-      }
-      break;
+  int idx = findContactIdx(id.pub_key, PUB_KEY_SIZE);
+  if (idx >= 0) {  // is from one of our contacts
+    from = fetchContact(idx);
+    if (from == NULL) {
+      MESH_DEBUG_PRINTLN("onAdvertRecv: unable to load contact");
+      return;
+    }
+    if (timestamp <= from->last_advert_timestamp) {  // check for replay attacks!!
+      MESH_DEBUG_PRINTLN("onAdvertRecv: Possible replay attack, name: %s", from->name);
+      return;
     }
   }
 
@@ -165,6 +186,7 @@ void BaseChatMesh::onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id,
     }
     from->last_advert_timestamp = timestamp;
     from->lastmod = getRTCClock()->getCurrentTime();
+    reindexContact(*from);
 
   onDiscoveredContact(*from, is_new, packet->path_len, packet->path);       // let UI know
 }
@@ -172,7 +194,7 @@ void BaseChatMesh::onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id,
 int BaseChatMesh::searchPeersByHash(const uint8_t* hash) {
   int n = 0;
   for (int i = 0; i < num_contacts && n < MAX_SEARCH_RESULTS; i++) {
-    if (contacts[i].id.isHashMatch(hash)) {
+    if (memcmp(contact_index[i].pub_key, hash, PATH_HASH_SIZE) == 0) {
       matching_peer_indexes[n++] = i;  // store the INDEXES of matching contacts (for subsequent 'peer' methods)
     }
   }
@@ -181,8 +203,9 @@ int BaseChatMesh::searchPeersByHash(const uint8_t* hash) {
 
 void BaseChatMesh::getPeerSharedSecret(uint8_t* dest_secret, int peer_idx) {
   int i = matching_peer_indexes[peer_idx];
-  if (i >= 0 && i < num_contacts) {
-    memcpy(dest_secret, contacts[i].getSharedSecret(self_id), PUB_KEY_SIZE);
+  ContactInfo* c;
+  if (i >= 0 && i < num_contacts && (c = fetchContact(i)) != NULL) {
+    memcpy(dest_secret, c->getSharedSecret(self_id), PUB_KEY_SIZE);
   } else {
     MESH_DEBUG_PRINTLN("getPeerSharedSecret: Invalid peer idx: %d", i);
   }
@@ -190,12 +213,13 @@ void BaseChatMesh::getPeerSharedSecret(uint8_t* dest_secret, int peer_idx) {
 
 void BaseChatMesh::onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender_idx, const uint8_t* secret, uint8_t* data, size_t len) {
   int i = matching_peer_indexes[sender_idx];
-  if (i < 0 || i >= num_contacts) {
+  ContactInfo* fp;
+  if (i < 0 || i >= num_contacts || (fp = fetchContact(i)) == NULL) {
     MESH_DEBUG_PRINTLN("onPeerDataRecv: Invalid sender idx: %d", i);
     return;
   }
 
-  ContactInfo& from = contacts[i];
+  ContactInfo& from = *fp;
 
   if (type == PAYLOAD_TYPE_TXT_MSG && len > 5) {
     uint32_t timestamp;
@@ -247,6 +271,49 @@ void BaseChatMesh::onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender
       } else {
         sendAckTo(from, ack_hash);
       }
+    } else if (flags == TXT_TYPE_ROOM_KEY && len >= 6 + CIPHER_KEY_SIZE) {
+      ConnectionInfo* conn = findConnection(from.id.pub_key);
+      if (conn && data[5] != 0) {
+        conn->room_key_id = data[5];
+        memcpy(conn->room_key, &data[6], CIPHER_KEY_SIZE);
+        mesh::Utils::sha256(&conn->room_key_hash, 1, conn->room_key, CIPHER_KEY_SIZE);
+      }
+      // NOTE: no ACK, we confirm key_id in next KEEP_ALIVE
+    } else if (flags == TXT_TYPE_SIGNED_BUNDLE && len > 6) {
+      // count, then records of: timestamp(4), sender_prefix(4), text_len(1), text
+      int count = data[5];
+      size_t i = 6;
+      for (int n = 0; n < count; n++) {
+        if (i + 9 > len || i + 9 + data[i + 8] > len) {
+          MESH_DEBUG_PRINTLN("onPeerDataRecv: malformed bundle");
+          return;   // no ACK, so will be re-sent
+        }
+        i += 9 + data[i + 8];
+      }
+      from.lastmod = getRTCClock()->getCurrentTime(); // update last heard time
+
+      char text[MAX_PACKET_PAYLOAD];
+      for (size_t k = 6; k < i; k += 9 + data[k + 8]) {
+        uint32_t post_timestamp;
+        memcpy(&post_timestamp, &data[k], 4);
+        if (post_timestamp > from.sync_since) {
+          from.sync_since = post_timestamp;
+        }
+        memcpy(text, &data[k + 9], data[k + 8]);
+        text[data[k + 8]] = 0;
+        onSignedMessageRecv(from, packet, post_timestamp, &data[k + 4], text);  // let UI know
+      }
+
+      uint32_t ack_hash;    // calc truncated hash of the whole bundle + OUR pub_key, to prove to sender that we got it
+      mesh::Utils::sha256((uint8_t *) &ack_hash, 4, data, i, self_id.pub_key, PUB_KEY_SIZE);
+
+      if (packet->isRouteFlood()) {
+        mesh::Packet* path = createPathReturn(from.id, secret, packet->path, packet->path_len,
+                                                PAYLOAD_TYPE_ACK, (uint8_t *) &ack_hash, 4);
+        if (path) sendFloodScoped(from, path, TXT_ACK_DELAY);
+      } else {
+        sendAckTo(from, ack_hash);
+      }
     } else {
       MESH_DEBUG_PRINTLN("onPeerDataRecv: unsupported message type: %u", (uint32_t) flags);
     }
@@ -282,28 +349,43 @@ void BaseChatMesh::onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender
 
 bool BaseChatMesh::onPeerPathRecv(mesh::Packet* packet, int sender_idx, const uint8_t* secret, uint8_t* path, uint8_t path_len, uint8_t extra_type, uint8_t* extra, uint8_t extra_len) {
   int i = matching_peer_indexes[sender_idx];
-  if (i < 0 || i >= num_contacts) {
+  ContactInfo* fp;
+  if (i < 0 || i >= num_contacts || (fp = fetchContact(i)) == NULL) {
     MESH_DEBUG_PRINTLN("onPeerPathRecv: Invalid sender idx: %d", i);
     return false;
   }
 
-  ContactInfo& from = contacts[i];
+  ContactInfo& from = *fp;
 
-  return onContactPathRecv(from, packet->path, packet->path_len, path, path_len, extra_type, extra, extra_len);
+  // SNR of last hop to us is only a guide to first hop of out_path, if it is the same link
+  path_recv_snr = PATH_SNR_UNKNOWN;
+  if (packet->path_len == 0 ? path_len == 0 : (path_len > 0 && path[0] == packet->path[packet->path_len - 1])) {
+    path_recv_snr = (int8_t)(packet->getSNR() * 4);
+  }
+  bool rc = onContactPathRecv(from, packet->path, packet->path_len, path, path_len, extra_type, extra, extra_len);
+  path_recv_snr = PATH_SNR_UNKNOWN;
+  return rc;
 }
 
 bool BaseChatMesh::onContactPathRecv(ContactInfo& from, uint8_t* in_path, uint8_t in_path_len, uint8_t* out_path, uint8_t out_path_len, uint8_t extra_type, uint8_t* extra, uint8_t extra_len) {
-  // NOTE: default impl, we just replace the current 'out_path' regardless, whenever sender sends us a new out_path.
-  // FUTURE: could store multiple out_paths per contact, and try to find which is the 'best'(?)
-  memcpy(from.out_path, out_path, from.out_path_len = out_path_len);  // store a copy of path, for sendDirect()
-  from.lastmod = getRTCClock()->getCurrentTime();
+  // NOTE: default impl, we use the new out_path, but keep the last few sender has sent us, to fail-over to the 'best' scoring
+  uint32_t now = getRTCClock()->getCurrentTime();
+  auto cand = path_table.onPathRecv(from.id.pub_key, out_path, out_path_len, path_recv_snr, now);
+  if (cand) {
+    memcpy(from.out_path, cand->path, from.out_path_len = cand->path_len);  // store a copy of path, for sendDirect()
+  } else {
+    memcpy(from.out_path, out_path, from.out_path_len = out_path_len);
+  }
+  from.lastmod = now;
 
   onContactPathUpdated(from);
 
   if (extra_type == PAYLOAD_TYPE_ACK && extra_len >= 4) {
     // also got an encoded ACK!
-    if (processAck(extra) != NULL) {
+    ContactInfo* acked;
+    if ((acked = processAck(extra)) != NULL) {
       txt_send_timeout = 0;   // matched one we're waiting for, cancel timeout timer
+      onDirectAcked(*acked);
     }
   } else if (extra_type == PAYLOAD_TYPE_RESPONSE && extra_len > 0) {
     onContactResponse(from, extra, extra_len);
@@ -315,6 +397,7 @@ void BaseChatMesh::onAckRecv(mesh::Packet* packet, uint32_t ack_crc) {
   ContactInfo* from;
   if ((from = processAck((uint8_t *)&ack_crc)) != NULL) {
     txt_send_timeout = 0;   // matched one we're waiting for, cancel timeout timer
+    onDirectAcked(*from);
     packet->markDoNotRetransmit();   // ACK was for this node, so don't retransmit
 
     if (packet->isRouteFlood() && from->out_path_len >= 0) {
@@ -324,6 +407,45 @@ void BaseChatMesh::onAckRecv(mesh::Packet* packet, uint32_t ack_crc) {
   }
 }
 
+void BaseChatMesh::onDirectSent(const ContactInfo& recipient) {
+  if (path_table.onSent(recipient.id.pub_key, recipient.out_path, recipient.out_path_len)) {
+    memcpy(pending_direct_key, recipient.id.pub_key, sizeof(pending_direct_key));
+    memcpy(pending_direct_path, recipient.out_path, pending_direct_len = recipient.out_path_len);
+  } else {
+    pending_direct_len = -1;
+  }
+}
+
+void BaseChatMesh::onDirectAcked(const ContactInfo& from) {
+  if (pending_direct_len >= 0 && memcmp(from.id.pub_key, pending_direct_key, sizeof(pending_direct_key)) == 0) {
+    path_table.onDelivered(pending_direct_key, pending_direct_path, pending_direct_len);
+  }
+  pending_direct_len = -1;
+}
+
+void BaseChatMesh::onDirectTimeout() {
+  if (pending_direct_len < 0) return;
+
+  uint32_t now = getRTCClock()->getCurrentTime();
+  auto next = path_table.onFailed(pending_direct_key, pending_direct_path, pending_direct_len, now);
+  ContactInfo* contact = lookupContactByPubKey(pending_direct_key, sizeof(pending_direct_key));
+  if (contact && contact->out_path_len == pending_direct_len && memcmp(contact->out_path, pending_direct_path, pending_direct_len) == 0) {
+    if (next) {   // fail-over to next best candidate
+      memcpy(contact->out_path, next->path, contact->out_path_len = next->path_len);
+    } else {
+      contact->out_path_len = -1;   // no usable candidates left, so fallback to flood
+    }
+    contact->lastmod = now;
+    onContactPathUpdated(*contact);
+  }
+  pending_direct_len = -1;
+}
+
+void BaseChatMesh::onPathTraced(const uint8_t* path_hashes, const uint8_t* path_snrs, uint8_t path_len, uint8_t flags) {
+  if ((flags & 0x03) != 0) return;   // only for 1-byte path hashes
+  path_table.onTrace(path_hashes, (const int8_t *) path_snrs, path_len);
+}
+
 void BaseChatMesh::handleReturnPathRetry(const ContactInfo& contact, const uint8_t* path, uint8_t path_len) {
   // NOTE: simplest impl is just to re-send a reciprocal return path to sender (DIRECTLY)
   //        override this method in various firmwares, if there's a better strategy
@@ -331,19 +453,51 @@ void BaseChatMesh::handleReturnPathRetry(const ContactInfo& contact, const uint8
   if (rpath) sendDirect(rpath, contact.out_path, contact.out_path_len, 3000);   // 3 second delay
 }
 
-#ifdef MAX_GROUP_CHANNELS
 int BaseChatMesh::searchChannelsByHash(const uint8_t* hash, mesh::GroupChannel dest[], int max_matches) {
   int n = 0;
+#ifdef MAX_GROUP_CHANNELS
   for (int i = 0; i < MAX_GROUP_CHANNELS && n < max_matches; i++) {
     if (channels[i].channel.hash[0] == hash[0]) {
       dest[n++] = channels[i].channel;
     }
   }
+#endif
+  for (int i = 0; i < MAX_CONNECTIONS && n < max_matches; i++) {   // room servers' group keys
+    if (connections[i].keep_alive_millis > 0 && connections[i].room_key_id && connections[i].room_key_hash == hash[0]) {
+      auto ch = &dest[n++];
+      memset(ch, 0, sizeof(*ch));
+      ch->hash[0] = connections[i].room_key_hash;
+      memcpy(ch->secret, connections[i].room_key, CIPHER_KEY_SIZE);
+    }
+  }
   return n;
 }
-#endif
 
 void BaseChatMesh::onGroupDataRecv(mesh::Packet* packet, uint8_t type, const mesh::GroupChannel& channel, uint8_t* data, size_t len) {
+  if (type == PAYLOAD_TYPE_GRP_DATA && len > 13 && (data[4] >> 2) == TXT_TYPE_SIGNED_PLAIN) {  // live post from a room server?
+    for (int i = 0; i < MAX_CONNECTIONS; i++) {
+      auto conn = &connections[i];
+      if (conn->keep_alive_millis == 0 || conn->room_key_id == 0 || memcmp(conn->room_key, channel.secret, CIPHER_KEY_SIZE) != 0) continue;
+
+      ContactInfo* from = lookupContactByPubKey(conn->server_id.pub_key, PUB_KEY_SIZE);
+      if (from == NULL) return;
+
+      uint32_t timestamp, prev_timestamp;
+      memcpy(&timestamp, data, 4);
+      memcpy(&prev_timestamp, &data[5], 4);
+      data[len] = 0;
+
+      if (prev_timestamp <= from->sync_since && timestamp > from->sync_since) {
+        from->sync_since = timestamp;   // only if no gap, else server catches us up after next KEEP_ALIVE
+      }
+      from->lastmod = getRTCClock()->getCurrentTime();
+      if (memcmp(&data[9], self_id.pub_key, 4) != 0) {   // our own posts aren't shown (same as direct sync)
+        onSignedMessageRecv(*from, packet, timestamp, &data[9], (const char *) &data[13]);
+      }
+      return;
+    }
+  }
+
   uint8_t txt_type = data[4];
   if (type == PAYLOAD_TYPE_GRP_TXT && len > 5 && (txt_type >> 2) == 0) {  // 0 = plain text msg
     uint32_t timestamp;
@@ -389,10 +543,12 @@ int  BaseChatMesh::sendMessage(const ContactInfo& recipient, uint32_t timestamp,
   if (recipient.out_path_len < 0) {
     sendFloodScoped(recipient, pkt);
     txt_send_timeout = futureMillis(est_timeout = calcFloodTimeoutMillisFor(t));
+    pending_direct_len = -1;
     rc = MSG_SEND_SENT_FLOOD;
   } else {
     sendDirect(pkt, recipient.out_path, recipient.out_path_len);
     txt_send_timeout = futureMillis(est_timeout = calcDirectTimeoutMillisFor(t, recipient.out_path_len));
+    onDirectSent(recipient);
     rc = MSG_SEND_SENT_DIRECT;
   }
   return rc;
@@ -415,10 +571,12 @@ int  BaseChatMesh::sendCommandData(const ContactInfo& recipient, uint32_t timest
   if (recipient.out_path_len < 0) {
     sendFloodScoped(recipient, pkt);
     txt_send_timeout = futureMillis(est_timeout = calcFloodTimeoutMillisFor(t));
+    pending_direct_len = -1;
     rc = MSG_SEND_SENT_FLOOD;
   } else {
     sendDirect(pkt, recipient.out_path, recipient.out_path_len);
     txt_send_timeout = futureMillis(est_timeout = calcDirectTimeoutMillisFor(t, recipient.out_path_len));
+    onDirectSent(recipient);
     rc = MSG_SEND_SENT_DIRECT;
   }
   return rc;
@@ -482,14 +640,16 @@ int BaseChatMesh::sendLogin(const ContactInfo& recipient, const char* password,
   mesh::Packet* pkt;
   {
     int tlen;
-    uint8_t temp[24];
+    uint8_t temp[26];
     uint32_t now = getRTCClock()->getCurrentTimeUnique();
     memcpy(temp, &now, 4);   // mostly an extra blob to help make packet_hash unique
     if (recipient.type == ADV_TYPE_ROOM) {
       memcpy(&temp[4], &recipient.sync_since, 4);
       int len = strlen(password); if (len > 15) len = 15;  // max 15 chars currently
       memcpy(&temp[8], password, len);
-      tlen = 8 + len;
+      temp[8 + len] = 0;   // older servers ignore anything after password
+      temp[9 + len] = LOGIN_CAP_SIGNED_BUNDLE | LOGIN_CAP_ROOM_KEY;
+      tlen = 10 + len;
     } else {
       int len = strlen(password); if (len > 15) len = 15;  // max 15 chars currently
       memcpy(&temp[4], password, len);
@@ -594,17 +754,20 @@ int  BaseChatMesh::sendRequest(const ContactInfo& recipient, uint8_t req_type, u
 
 bool BaseChatMesh::startConnection(const ContactInfo& contact, uint16_t keep_alive_secs) {
   int use_idx = -1;
+  bool existing = false;
   for (int i = 0; i < MAX_CONNECTIONS; i++) {
     if (connections[i].keep_alive_millis == 0) {  // free slot?
       use_idx = i;
     } else if (connections[i].server_id.matches(contact.id)) {  // already in table?
       use_idx = i;
+      existing = true;
       break;
     }
   }
   if (use_idx < 0) {
     return false;   // table is full
   }
+  if (!existing) connections[use_idx].room_key_id = 0;
   connections[use_idx].server_id = contact.id;
   uint32_t interval = connections[use_idx].keep_alive_millis = ((uint32_t)keep_alive_secs)*1000;
   connections[use_idx].next_ping = futureMillis(interval);
@@ -620,11 +783,19 @@ void BaseChatMesh::stopConnection(const uint8_t* pub_key) {
       connections[i].next_ping = 0;
       connections[i].expected_ack = 0;
       connections[i].last_activity = 0;
+      connections[i].room_key_id = 0;
       break;
     }
   }
 }
 
+ConnectionInfo* BaseChatMesh::findConnection(const uint8_t* pub_key) {
+  for (int i = 0; i < MAX_CONNECTIONS; i++) {
+    if (connections[i].keep_alive_millis > 0 && connections[i].server_id.matches(pub_key)) return &connections[i];
+  }
+  return NULL;
+}
+
 bool BaseChatMesh::hasConnectionTo(const uint8_t* pub_key) {
   for (int i = 0; i < MAX_CONNECTIONS; i++) {
     if (connections[i].keep_alive_millis > 0 && connections[i].server_id.matches(pub_key)) return true;
@@ -674,6 +845,7 @@ void BaseChatMesh::checkConnections() {
       connections[i].next_ping = 0;
       connections[i].expected_ack = 0;
       connections[i].last_activity = 0;
+      connections[i].room_key_id = 0;
       continue;
     }
 
@@ -689,16 +861,17 @@ void BaseChatMesh::checkConnections() {
       }
 
       // send KEEP_ALIVE request
-      uint8_t data[9];
+      uint8_t data[10];
       uint32_t now = getRTCClock()->getCurrentTimeUnique();
       memcpy(data, &now, 4);
       data[4] = REQ_TYPE_KEEP_ALIVE;
       memcpy(&data[5], &contact->sync_since, 4);
+      data[9] = connections[i].room_key_id;   // so server knows whether to send (new) room group key
     
       // calc expected ACK reply
       mesh::Utils::sha256((uint8_t *)&connections[i].expected_ack, 4, data, 9, self_id.pub_key, PUB_KEY_SIZE);
 
-      auto pkt = createDatagram(PAYLOAD_TYPE_REQ, contact->id, contact->getSharedSecret(self_id), data, 9);
+      auto pkt = createDatagram(PAYLOAD_TYPE_REQ, contact->id, contact->getSharedSecret(self_id), data, 10);
       if (pkt) {
         sendDirect(pkt, contact->out_path, contact->out_path_len);
       }
@@ -711,76 +884,408 @@ void BaseChatMesh::checkConnections() {
 
 void BaseChatMesh::resetPathTo(ContactInfo& recipient) {
   recipient.out_path_len = -1;
+  path_table.remove(recipient.id.pub_key);
 }
 
-static ContactInfo* table;  // pass via global :-(
+static uint32_t calcRecordCRC(const ContactInfo& c) {   // FNV-1a, over the persisted fields
+  uint32_t h = 2166136261u;
+  auto mix = [&h](const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t *) data;
+    while (len--) { h ^= *p++; h *= 16777619u; }
+  };
+  mix(c.id.pub_key, PUB_KEY_SIZE);
+  mix(c.name, sizeof(c.name));
+  mix(&c.type, 1);
+  mix(&c.flags, 1);
+  mix(&c.out_path_len, 1);
+  mix(c.out_path, sizeof(c.out_path));
+  mix(&c.last_advert_timestamp, 4);
+  mix(&c.lastmod, 4);
+  mix(&c.gps_lat, 4);
+  mix(&c.gps_lon, 4);
+  mix(&c.sync_since, 4);
+  return h == 0 ? 1 : h;   // 0 is reserved for 'not saved'
+}
 
-static int cmp_adv_timestamp(const void *a, const void *b) {
-  int a_idx = *((int *)a);
-  int b_idx = *((int *)b);
-  if (table[b_idx].last_advert_timestamp > table[a_idx].last_advert_timestamp) return 1;
-  if (table[b_idx].last_advert_timestamp < table[a_idx].last_advert_timestamp) return -1;
-  return 0;
+void BaseChatMesh::resetContacts() {
+  num_contacts = 0;
+  for (int i = 0; i < CONTACT_CACHE_SIZE; i++) cache_owner[i] = -1;
+  memset(rec_used, 0, sizeof(rec_used));
+  recent_head = recent_tail = -1;
+  num_name_order = 0;
+  secrets_pending = false;
 }
 
-void BaseChatMesh::scanRecentContacts(int last_n, ContactVisitor* visitor) {
-  for (int i = 0; i < num_contacts; i++) {  // sort the INDEXES into contacts[]
-    sort_array[i] = i;
+int BaseChatMesh::allocRecId() {
+  for (int i = 0; i < MAX_CONTACTS; i++) {
+    if ((rec_used[i / 8] & (1 << (i & 7))) == 0) {
+      rec_used[i / 8] |= (1 << (i & 7));
+      return i;
+    }
   }
-  table = contacts; // pass via global *sigh* :-(
-  qsort(sort_array, num_contacts, sizeof(sort_array[0]), cmp_adv_timestamp);
+  return 0;  // should not happen, always called with num_contacts < MAX_CONTACTS
+}
 
-  if (last_n == 0) {
-    last_n = num_contacts;   // scan ALL
-  } else {
-    if (last_n > num_contacts) last_n = num_contacts;
+void BaseChatMesh::writeBackSlot(int slot) {
+  const ContactInfo& c = contact_cache[slot];
+  auto e = &contact_index[cache_owner[slot]];
+  e->lastmod = c.lastmod;
+  e->flags = c.flags;
+
+  uint32_t crc = calcRecordCRC(c);
+  if (crc != cache_crc[slot]) {   // modified since last read/write?
+    if (writeContactRecord(e->rec_id, c)) {
+      cache_crc[slot] = crc;
+    } else {
+      MESH_DEBUG_PRINTLN("writeBackSlot: unable to write contact record: %d", (uint32_t) e->rec_id);
+    }
+  }
+}
+
+int BaseChatMesh::allocCacheSlot() {
+  int lru_slot = 0;
+  for (int i = 0; i < CONTACT_CACHE_SIZE; i++) {
+    if (cache_owner[i] < 0) return i;   // free slot
+    if (cache_lru[i] < cache_lru[lru_slot]) lru_slot = i;
+  }
+
+  // evict least recently used
+  writeBackSlot(lru_slot);
+  contact_index[cache_owner[lru_slot]].cache_idx = -1;
+  cache_owner[lru_slot] = -1;
+  return lru_slot;
+}
+
+ContactInfo* BaseChatMesh::fetchContact(int idx) {
+  auto e = &contact_index[idx];
+  if (e->cache_idx >= 0) {
+    cache_lru[e->cache_idx] = ++cache_clock;
+    return &contact_cache[e->cache_idx];
+  }
+
+  int slot = allocCacheSlot();
+  ContactInfo* c = &contact_cache[slot];
+  if (!readContactRecord(e->rec_id, *c)) {
+    MESH_DEBUG_PRINTLN("fetchContact: unable to read contact record: %d", (uint32_t) e->rec_id);
+    return NULL;   // NOTE: slot is left free
   }
-  for (int i = 0; i < last_n; i++) {
-    visitor->onContactVisit(contacts[sort_array[i]]);
+  c->shared_secret_valid = false;
+  cache_owner[slot] = idx;
+  cache_crc[slot] = calcRecordCRC(*c);
+  cache_lru[slot] = ++cache_clock;
+  e->cache_idx = slot;
+  secrets_pending = true;
+  return c;
+}
+
+void BaseChatMesh::syncCachedEntries() {   // sub-classes can modify cached contacts directly, so refresh the copies
+  for (int i = 0; i < CONTACT_CACHE_SIZE; i++) {
+    if (cache_owner[i] >= 0) {
+      auto e = &contact_index[cache_owner[i]];
+      e->lastmod = contact_cache[i].lastmod;
+      e->flags = contact_cache[i].flags;
+    }
   }
 }
 
-ContactInfo* BaseChatMesh::searchContactsByPrefix(const char* name_prefix) {
-  int len = strlen(name_prefix);
+void BaseChatMesh::updateIndexEntry(int idx, const ContactInfo& contact) {
+  auto e = &contact_index[idx];
+  memcpy(e->pub_key, contact.id.pub_key, CONTACT_KEY_PREFIX_SIZE);
+  e->last_advert_timestamp = contact.last_advert_timestamp;
+  e->lastmod = contact.lastmod;
+  e->flags = contact.flags;
+
+  char name[sizeof(contact.name) + 1];
+  StrHelper::strncpy(name, contact.name, sizeof(name));
+  const char* sp = name;
+  int len = 0;
+  e->key_flags = 0;
+  while (StrHelper::nextFoldedChar(sp) != 0) {
+    if (sp - name >= CONTACT_NAME_KEY_SIZE) {   // only whole chars, and room for null
+      e->key_flags |= CONTACT_NAME_KEY_TRUNCATED;
+      break;
+    }
+    len = sp - name;
+  }
+  memcpy(e->name_key, name, len);
+  e->name_key[len] = 0;
+}
+
+int BaseChatMesh::findContactIdx(const uint8_t* pub_key, int prefix_len) {
+  int n = prefix_len < CONTACT_KEY_PREFIX_SIZE ? prefix_len : CONTACT_KEY_PREFIX_SIZE;
   for (int i = 0; i < num_contacts; i++) {
-    auto c = &contacts[i];
-    if (memcmp(c->name, name_prefix, len) == 0) return c;
+    if (memcmp(contact_index[i].pub_key, pub_key, n) != 0) continue;
+
+    if (prefix_len > CONTACT_KEY_PREFIX_SIZE) {   // need the full key to confirm
+      // NOTE: read direct, rather than fetchContact(), so that rejected candidates don't evict from cache
+      ContactInfo tmp;
+      const ContactInfo* c = &tmp;
+      if (contact_index[i].cache_idx >= 0) {
+        c = &contact_cache[contact_index[i].cache_idx];
+      } else if (!readContactRecord(contact_index[i].rec_id, tmp)) {
+        continue;
+      }
+      if (memcmp(c->id.pub_key, pub_key, prefix_len) != 0) continue;
+    }
+    return i;
   }
-  return NULL;  // not found
+  return -1;  // not found
 }
 
-ContactInfo* BaseChatMesh::lookupContactByPubKey(const uint8_t* pub_key, int prefix_len) {
+void BaseChatMesh::linkRecent(int idx) {
+  uint32_t ts = contact_index[idx].last_advert_timestamp;
+  int after;
+  if (recent_head < 0 || ts >= contact_index[recent_head].last_advert_timestamp) {
+    after = -1;   // new head (the common case, ie. a fresh advert)
+  } else if (ts <= contact_index[recent_tail].last_advert_timestamp) {
+    after = recent_tail;   // new tail (eg. loading contacts that were saved in oldest-first order)
+  } else {
+    after = recent_head;
+    while (contact_index[recent_next[after]].last_advert_timestamp > ts) {
+      after = recent_next[after];
+    }
+  }
+
+  int before = after < 0 ? recent_head : recent_next[after];
+  recent_prev[idx] = after;
+  recent_next[idx] = before;
+  if (after < 0) recent_head = idx; else recent_next[after] = idx;
+  if (before < 0) recent_tail = idx; else recent_prev[before] = idx;
+}
+
+void BaseChatMesh::unlinkRecent(int idx) {
+  if (recent_prev[idx] == RECENT_UNLINKED) return;
+
+  int prev = recent_prev[idx], next = recent_next[idx];
+  if (prev < 0) recent_head = next; else recent_next[prev] = next;
+  if (next < 0) recent_tail = prev; else recent_prev[next] = prev;
+  recent_prev[idx] = RECENT_UNLINKED;
+}
+
+int BaseChatMesh::compareContactName(int idx, const char* name, bool as_prefix) {
+  auto e = &contact_index[idx];
+  const char* kp = e->name_key;
+  const char* np = name;
+  while (true) {
+    uint32_t cn = StrHelper::nextFoldedChar(np);
+    if (cn == 0 && as_prefix) return 0;
+
+    uint32_t ck = StrHelper::nextFoldedChar(kp);
+    if (ck == 0 && (e->key_flags & CONTACT_NAME_KEY_TRUNCATED)) break;   // need the full name to decide
+    if (ck != cn) return ck < cn ? -1 : 1;
+    if (ck == 0) return 0;
+  }
+
+  // NOTE: read direct, rather than fetchContact(), so that searching doesn't evict from cache
+  ContactInfo tmp;
+  const ContactInfo* c = &tmp;
+  if (e->cache_idx >= 0) {
+    c = &contact_cache[e->cache_idx];
+  } else if (!readContactRecord(e->rec_id, tmp)) {
+    return -1;
+  }
+
+  char full[sizeof(c->name) + 1];
+  StrHelper::strncpy(full, c->name, sizeof(full));
+  if (as_prefix && StrHelper::startsWithFolded(full, name)) return 0;
+  return StrHelper::compareFolded(full, name);
+}
+
+int BaseChatMesh::findNameOrderPos(const char* name) {
+  int lo = 0, hi = num_name_order;   // binary search for first entry >= name
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (compareContactName(name_order[mid], name, false) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+void BaseChatMesh::insertNameOrder(int idx, const char* name) {
+  int pos = findNameOrderPos(name);
+  memmove(&name_order[pos + 1], &name_order[pos], (num_name_order - pos) * sizeof(name_order[0]));
+  name_order[pos] = idx;
+  num_name_order++;
+}
+
+void BaseChatMesh::removeNameOrder(int idx) {
+  for (int pos = 0; pos < num_name_order; pos++) {
+    if (name_order[pos] == idx) {
+      num_name_order--;
+      memmove(&name_order[pos], &name_order[pos + 1], (num_name_order - pos) * sizeof(name_order[0]));
+      break;
+    }
+  }
+}
+
+void BaseChatMesh::reindexContact(const ContactInfo& contact) {
+  int slot = &contact - contact_cache;
+  if (slot < 0 || slot >= CONTACT_CACHE_SIZE || cache_owner[slot] < 0) return;   // not one of ours, eg. a temp copy
+
+  int idx = cache_owner[slot];
+  if (recent_prev[idx] != RECENT_UNLINKED) {
+    unlinkRecent(idx);
+    removeNameOrder(idx);
+  }
+  updateIndexEntry(idx, contact);
+  linkRecent(idx);
+
+  char name[sizeof(contact.name) + 1];   // copy, as contact may get evicted while searching
+  StrHelper::strncpy(name, contact.name, sizeof(name));
+  insertNameOrder(idx, name);
+}
+
+bool BaseChatMesh::loadContact(const ContactInfo& contact, uint32_t rec_id) {
+  if (rec_id >= MAX_CONTACTS || (rec_used[rec_id / 8] & (1 << (rec_id & 7)))) {
+    // eg. MAX_CONTACTS has been reduced, so re-home this record
+    if (!addContact(contact)) return false;
+    if (rec_id >= MAX_CONTACTS) deleteContactRecord(rec_id);
+    return true;
+  }
+  if (num_contacts >= MAX_CONTACTS) return false;
+
+  int idx = num_contacts++;
+  auto e = &contact_index[idx];
+  memset(e, 0, sizeof(*e));
+  e->rec_id = rec_id;
+  e->cache_idx = -1;
+  rec_used[rec_id / 8] |= (1 << (rec_id & 7));
+
+  for (int i = 0; i < CONTACT_CACHE_SIZE; i++) {   // keep in cache while there's room (no evicting)
+    if (cache_owner[i] < 0) {
+      contact_cache[i] = contact;
+      contact_cache[i].shared_secret_valid = false;
+      cache_owner[i] = idx;
+      cache_crc[i] = calcRecordCRC(contact);
+      cache_lru[i] = ++cache_clock;
+      e->cache_idx = i;
+      secrets_pending = true;
+      break;
+    }
+  }
+  updateIndexEntry(idx, contact);
+  linkRecent(idx);
+
+  char name[sizeof(contact.name) + 1];
+  StrHelper::strncpy(name, contact.name, sizeof(name));
+  insertNameOrder(idx, name);
+  return true;
+}
+
+void BaseChatMesh::flushContacts() {
+  for (int i = 0; i < CONTACT_CACHE_SIZE; i++) {
+    if (cache_owner[i] >= 0) writeBackSlot(i);
+  }
+}
+
+bool BaseChatMesh::cacheAllContacts() {
+  if (num_contacts > CONTACT_CACHE_SIZE) return false;
+
   for (int i = 0; i < num_contacts; i++) {
-    auto c = &contacts[i];
-    if (memcmp(c->id.pub_key, pub_key, prefix_len) == 0) return c;
+    if (fetchContact(i) == NULL) return false;   // NOTE: won't evict, as there's a slot for each
+  }
+  return true;
+}
+
+void BaseChatMesh::rewriteAllContacts() {
+  for (int i = num_contacts - 1; i >= 0; i--) {
+    int slot = contact_index[i].cache_idx;
+    if (slot >= 0) {
+      cache_crc[slot] = 0;   // force a write
+    } else {
+      removeContactAt(i);   // record is gone, unable to recover it
+    }
+  }
+  flushContacts();
+}
+
+void BaseChatMesh::scanRecentContacts(int last_n, ContactVisitor* visitor) {
+  if (last_n == 0) last_n = num_contacts;   // scan ALL
+
+  for (int i = recent_head; i >= 0 && last_n > 0; i = recent_next[i], last_n--) {
+    ContactInfo* c = fetchContact(i);
+    if (c) visitor->onContactVisit(*c);
+  }
+}
+
+ContactInfo* BaseChatMesh::searchContactsByPrefix(const char* name_prefix) {
+  int pos = findNameOrderPos(name_prefix);
+  if (pos < num_name_order && compareContactName(name_order[pos], name_prefix, true) == 0) {
+    return fetchContact(name_order[pos]);
   }
   return NULL;  // not found
 }
 
+int BaseChatMesh::searchContactsByPrefix(const char* name_prefix, ContactVisitor* visitor, int max_results) {
+  int n = 0;
+  // all names with this prefix are adjacent in name_order[], starting at the lower bound
+  for (int pos = findNameOrderPos(name_prefix); pos < num_name_order; pos++) {
+    if (compareContactName(name_order[pos], name_prefix, true) != 0) break;
+
+    ContactInfo* c = fetchContact(name_order[pos]);
+    if (c == NULL) continue;
+
+    visitor->onContactVisit(*c);
+    if (++n == max_results) break;
+  }
+  return n;
+}
+
+ContactInfo* BaseChatMesh::lookupContactByPubKey(const uint8_t* pub_key, int prefix_len) {
+  int idx = findContactIdx(pub_key, prefix_len);
+  return idx >= 0 ? fetchContact(idx) : NULL;
+}
+
 bool BaseChatMesh::addContact(const ContactInfo& contact) {
   ContactInfo* dest = allocateContactSlot();
   if (dest) {
     *dest = contact;
     dest->shared_secret_valid = false; // mark shared_secret as needing calculation
+    reindexContact(*dest);
     return true;  // success
   }
   return false;
 }
 
 bool BaseChatMesh::removeContact(ContactInfo& contact) {
-  int idx = 0;
-  while (idx < num_contacts && !contacts[idx].id.matches(contact.id)) {
-    idx++;
-  }
-  if (idx >= num_contacts) return false;   // not found
+  int idx = findContactIdx(contact.id.pub_key, PUB_KEY_SIZE);
+  if (idx < 0) return false;   // not found
+
+  removeContactAt(idx);
+  return true;  // Success
+}
 
-  // remove from contacts array
+void BaseChatMesh::removeContactAt(int idx) {
+  auto e = &contact_index[idx];
+  unlinkRecent(idx);
+  removeNameOrder(idx);
+  if (e->cache_idx >= 0) cache_owner[e->cache_idx] = -1;
+  deleteContactRecord(e->rec_id);
+  rec_used[e->rec_id / 8] &= ~(1 << (e->rec_id & 7));
+
+  // remove from contact_index array
   num_contacts--;
-  while (idx < num_contacts) {
-    contacts[idx] = contacts[idx + 1];
-    idx++;
+  for (int i = idx; i < num_contacts; i++) {
+    contact_index[i] = contact_index[i + 1];
+    recent_prev[i] = recent_prev[i + 1];
+    recent_next[i] = recent_next[i + 1];
+  }
+  // fix up the entries that pointed past the removed slot
+  for (int i = 0; i < num_contacts; i++) {
+    if (recent_prev[i] > idx) recent_prev[i]--;
+    if (recent_next[i] > idx) recent_next[i]--;
+  }
+  if (recent_head > idx) recent_head--;
+  if (recent_tail > idx) recent_tail--;
+  for (int i = 0; i < num_name_order; i++) {
+    if (name_order[i] > idx) name_order[i]--;
+  }
+  for (int i = 0; i < CONTACT_CACHE_SIZE; i++) {
+    if (cache_owner[i] > idx) cache_owner[i]--;
   }
-  return true;  // Success
 }
 
 #ifdef MAX_GROUP_CHANNELS
@@ -846,19 +1351,40 @@ int BaseChatMesh::findChannelIdx(const mesh::GroupChannel& ch) {
 bool BaseChatMesh::getContactByIdx(uint32_t idx, ContactInfo& contact) {
   if (idx >= num_contacts) return false;
 
-  contact = contacts[idx];
+  ContactInfo* c = fetchContact(idx);
+  if (c == NULL) return false;
+
+  contact = *c;
   return true;
 }
 
+uint32_t BaseChatMesh::getContactLastMod(uint32_t idx) const {
+  if (idx >= num_contacts) return 0;
+
+  int slot = contact_index[idx].cache_idx;
+  return slot >= 0 ? contact_cache[slot].lastmod : contact_index[idx].lastmod;  // cached copy may be newer
+}
+
 ContactsIterator BaseChatMesh::startContactsIterator() {
   return ContactsIterator();
 }
 
-bool ContactsIterator::hasNext(const BaseChatMesh* mesh, ContactInfo& dest) {
-  if (next_idx >= mesh->getNumContacts()) return false;
+bool ContactsIterator::hasNext(BaseChatMesh* mesh, ContactInfo& dest) {
+  while (next_idx < mesh->getNumContacts()) {
+    if (mesh->getContactByIdx(next_idx++, dest)) return true;
+  }
+  return false;
+}
 
-  dest = mesh->contacts[next_idx++];
-  return true;
+bool ContactsIterator::hasNext(BaseChatMesh* mesh, ContactInfo& dest, uint32_t modified_since) {
+  while (next_idx < mesh->getNumContacts()) {
+    if (mesh->getContactLastMod(next_idx) <= modified_since) {   // skip, without reading the whole contact
+      next_idx++;
+    } else if (mesh->getContactByIdx(next_idx++, dest)) {
+      return true;
+    }
+  }
+  return false;
 }
 
 void BaseChatMesh::loop() {
@@ -866,6 +1392,7 @@ void BaseChatMesh::loop() {
 
   if (txt_send_timeout && millisHasNowPassed(txt_send_timeout)) {
     // failed to get an ACK
+    onDirectTimeout();
     onSendTimeout();
     txt_send_timeout = 0;
   }
@@ -875,4 +1402,23 @@ void BaseChatMesh::loop() {
     releasePacket(_pendingLoopback);   // undo the obtainNewPacket()
     _pendingLoopback = NULL;
   }
+
+  precomputeSecrets();
+}
+
+void BaseChatMesh::precomputeSecrets() {
+  if (!secrets_pending || _radio->isReceiving() || _mgr->getOutboundCount(_ms->getMillis()) > 0) return;  // only when idle
+
+  unsigned long start = _ms->getMillis();
+  // most recently heard first, as most likely to be in contact next. NOTE: contacts not in cache are skipped
+  for (int i = recent_head; i >= 0; i = recent_next[i]) {
+    int slot = contact_index[i].cache_idx;
+    if (slot < 0 || contact_cache[slot].shared_secret_valid) continue;
+
+    if (_ms->getMillis() - start >= SECRET_PRECOMPUTE_BUDGET_MILLIS) return;   // resume in next loop()
+
+    contact_cache[slot].getSharedSecret(self_id);
+    num_secrets_precomputed++;
+  }
+  secrets_pending = false;   // all done
 }
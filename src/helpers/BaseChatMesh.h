@@ -4,6 +4,7 @@
 #include <Mesh.h>
 #include <helpers/AdvertDataHelpers.h>
 #include <helpers/TxtDataHelpers.h>
+#include <helpers/PathCandidates.h>
 
 #define MAX_TEXT_LEN    (10*CIPHER_BLOCK_SIZE)  // must be LESS than (MAX_PACKET_PAYLOAD - 4 - CIPHER_MAC_SIZE - 1)
 
@@ -30,13 +31,53 @@ class BaseChatMesh;
 class ContactsIterator {
   int next_idx = 0;
 public:
-  bool hasNext(const BaseChatMesh* mesh, ContactInfo& dest);
+  bool hasNext(BaseChatMesh* mesh, ContactInfo& dest);
+  bool hasNext(BaseChatMesh* mesh, ContactInfo& dest, uint32_t modified_since);  // only those with lastmod > modified_since
 };
 
 #ifndef MAX_CONTACTS
   #define MAX_CONTACTS  32
 #endif
 
+// number of fully materialised ContactInfo's kept in RAM. If less than MAX_CONTACTS, the rest are paged
+// in from storage on demand (sub-class must implement the *ContactRecord() methods)
+#ifndef CONTACT_CACHE_SIZE
+  #if defined(NRF52_PLATFORM) && MAX_CONTACTS > 64
+    #define CONTACT_CACHE_SIZE  64     // ~12KB, the rest are paged from flash
+  #else
+    #define CONTACT_CACHE_SIZE  MAX_CONTACTS
+  #endif
+#endif
+
+#if CONTACT_CACHE_SIZE < MAX_CONTACTS && CONTACT_CACHE_SIZE < 8
+  #error "CONTACT_CACHE_SIZE is too small"
+#endif
+
+// max time per loop() to spend pre-calculating contact shared secrets (when radio is idle)
+#ifndef SECRET_PRECOMPUTE_BUDGET_MILLIS
+  #define SECRET_PRECOMPUTE_BUDGET_MILLIS  20
+#endif
+
+#define CONTACT_KEY_PREFIX_SIZE   4
+#define CONTACT_NAME_KEY_SIZE    12
+
+#define CONTACT_NAME_KEY_TRUNCATED   0x01
+
+/**
+ *  \brief  compact in-RAM summary of every contact, so that lookups and orderings don't need the full ContactInfo.
+ *        Kept to 32 bytes, with the fields used by linear scans first.
+ */
+struct ContactIndexEntry {
+  uint8_t  pub_key[CONTACT_KEY_PREFIX_SIZE];   // prefix only
+  uint8_t  flags;       // copy of ContactInfo::flags
+  uint8_t  key_flags;   // CONTACT_NAME_KEY_*
+  int16_t  cache_idx;   // slot in contact_cache[], or -1 if not materialised
+  uint32_t lastmod;
+  uint32_t last_advert_timestamp;
+  uint16_t rec_id;      // slot in persistent storage
+  char     name_key[CONTACT_NAME_KEY_SIZE];    // leading chars of name (whole UTF-8 chars only)
+};
+
 #ifndef MAX_CONNECTIONS
   #define MAX_CONNECTIONS  16
 #endif
@@ -47,6 +88,9 @@ struct ConnectionInfo {
   uint32_t last_activity;
   uint32_t keep_alive_millis;
   uint32_t expected_ack;
+  uint8_t room_key_id;    // of room server's group key, 0 = none
+  uint8_t room_key_hash;
+  uint8_t room_key[CIPHER_KEY_SIZE];
 };
 
 #include "ChannelDetails.h"
@@ -56,13 +100,28 @@ struct ConnectionInfo {
  */
 class BaseChatMesh : public mesh::Mesh {
 
-  friend class ContactsIterator;
-
-  ContactInfo contacts[MAX_CONTACTS];
+  ContactIndexEntry contact_index[MAX_CONTACTS];
   int num_contacts;
-  int sort_array[MAX_CONTACTS];
+  ContactInfo contact_cache[CONTACT_CACHE_SIZE];
+  int16_t  cache_owner[CONTACT_CACHE_SIZE];   // INDEX into contact_index[], or -1 if slot is free
+  uint32_t cache_crc[CONTACT_CACHE_SIZE];     // checksum of record as last read/written, 0 = not yet saved
+  uint32_t cache_lru[CONTACT_CACHE_SIZE];
+  uint32_t cache_clock;
+  uint8_t  rec_used[(MAX_CONTACTS + 7) / 8];  // bitmap of allocated rec_id's
+  int16_t recent_head, recent_tail;    // recency list over contact_index[], newest last_advert_timestamp first
+  int16_t recent_prev[MAX_CONTACTS];
+  int16_t recent_next[MAX_CONTACTS];
+  int16_t name_order[MAX_CONTACTS];    // INDEXES into contact_index[], sorted by case-folded name
+  int num_name_order;
+  bool secrets_pending;    // some cached contacts may still need shared_secret calculated
+  uint32_t num_secrets_precomputed;
   int matching_peer_indexes[MAX_SEARCH_RESULTS];
   unsigned long txt_send_timeout;
+  PathCandidates path_table;
+  uint8_t pending_direct_key[6];     // contact of last direct send with a candidate path, if pending_direct_len >= 0
+  uint8_t pending_direct_path[MAX_PATH_SIZE];
+  int16_t pending_direct_len;
+  int8_t  path_recv_snr;             // first hop SNR (x4) of path currently being received, or PATH_SNR_UNKNOWN
 #ifdef MAX_GROUP_CHANNELS
   ChannelDetails channels[MAX_GROUP_CHANNELS];
   int num_channels;  // only for addChannel()
@@ -73,23 +132,50 @@ class BaseChatMesh : public mesh::Mesh {
 
   mesh::Packet* composeMsgPacket(const ContactInfo& recipient, uint32_t timestamp, uint8_t attempt, const char *text, uint32_t& expected_ack);
   void sendAckTo(const ContactInfo& dest, uint32_t ack_hash);
+  ContactInfo* fetchContact(int idx);   // materialise into contact_cache[], NULL if unable
+  int  allocCacheSlot();
+  void writeBackSlot(int slot);
+  void syncCachedEntries();
+  void updateIndexEntry(int idx, const ContactInfo& contact);
+  int  findContactIdx(const uint8_t* pub_key, int prefix_len);
+  int  allocRecId();
+  void removeContactAt(int idx);
+  void linkRecent(int idx);
+  void unlinkRecent(int idx);
+  int  compareContactName(int idx, const char* name, bool as_prefix);
+  int  findNameOrderPos(const char* name);
+  void insertNameOrder(int idx, const char* name);
+  void removeNameOrder(int idx);
+  void precomputeSecrets();
+  void onDirectSent(const ContactInfo& recipient);
+  void onDirectAcked(const ContactInfo& from);
+  void onDirectTimeout();
 
 protected:
   BaseChatMesh(mesh::Radio& radio, mesh::MillisecondClock& ms, mesh::RNG& rng, mesh::RTCClock& rtc, mesh::PacketManager& mgr, mesh::MeshTables& tables)
       : mesh::Mesh(radio, ms, rng, rtc, mgr, tables)
   { 
-    num_contacts = 0;
+    cache_clock = 0;
+    num_secrets_precomputed = 0;
+    resetContacts();
   #ifdef MAX_GROUP_CHANNELS
     memset(channels, 0, sizeof(channels));
     num_channels = 0;
   #endif
     txt_send_timeout = 0;
+    pending_direct_len = -1;
+    path_recv_snr = PATH_SNR_UNKNOWN;
     _pendingLoopback = NULL;
     memset(connections, 0, sizeof(connections));
   }
 
   void bootstrapRTCfromContacts();
-  void resetContacts() { num_contacts = 0; }
+  void resetContacts();
+  void reindexContact(const ContactInfo& contact);  // call after changing contact.name or last_advert_timestamp
+  bool loadContact(const ContactInfo& contact, uint32_t rec_id);  // add contact that is already in storage
+  void flushContacts();        // write back modified contacts, via writeContactRecord()
+  bool cacheAllContacts();     // page every contact into cache, false if they don't all fit
+  void rewriteAllContacts();   // eg. after storage was wiped. NOTE: call cacheAllContacts() BEFORE wiping
   void populateContactFromAdvert(ContactInfo& ci, const mesh::Identity& id, const AdvertDataParser& parser, uint32_t timestamp);
   ContactInfo* allocateContactSlot(); // helper to find slot for new contact
 
@@ -117,9 +203,17 @@ protected:
   virtual void sendFloodScoped(const ContactInfo& recipient, mesh::Packet* pkt, uint32_t delay_millis=0);
   virtual void sendFloodScoped(const mesh::GroupChannel& channel, mesh::Packet* pkt, uint32_t delay_millis=0);
 
+  /**
+   * \brief  per-hop SNRs from a received TRACE, to help score contacts' candidate paths
+   */
+  void onPathTraced(const uint8_t* path_hashes, const uint8_t* path_snrs, uint8_t path_len, uint8_t flags);
+
   // storage concepts, for sub-classes to override/implement
   virtual int  getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_buf[]) { return 0; }  // not implemented
   virtual bool putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], int len) { return false; }
+  virtual bool readContactRecord(uint32_t rec_id, ContactInfo& dest) { return false; }
+  virtual bool writeContactRecord(uint32_t rec_id, const ContactInfo& src) { return false; }
+  virtual void deleteContactRecord(uint32_t rec_id) { }
 
   // Mesh overrides
   void onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id, uint32_t timestamp, const uint8_t* app_data, size_t app_data_len) override;
@@ -128,13 +222,12 @@ protected:
   void onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender_idx, const uint8_t* secret, uint8_t* data, size_t len) override;
   bool onPeerPathRecv(mesh::Packet* packet, int sender_idx, const uint8_t* secret, uint8_t* path, uint8_t path_len, uint8_t extra_type, uint8_t* extra, uint8_t extra_len) override;
   void onAckRecv(mesh::Packet* packet, uint32_t ack_crc) override;
-#ifdef MAX_GROUP_CHANNELS
   int searchChannelsByHash(const uint8_t* hash, mesh::GroupChannel channels[], int max_matches) override;
-#endif
   void onGroupDataRecv(mesh::Packet* packet, uint8_t type, const mesh::GroupChannel& channel, uint8_t* data, size_t len) override;
 
   // Connections
   bool startConnection(const ContactInfo& contact, uint16_t keep_alive_secs);
+  ConnectionInfo* findConnection(const uint8_t* pub_key);
   void stopConnection(const uint8_t* pub_key);
   bool hasConnectionTo(const uint8_t* pub_key);
   void markConnectionActive(const ContactInfo& contact);
@@ -142,6 +235,10 @@ protected:
   void checkConnections();
 
 public:
+  // NOTE: ContactInfo pointers/references handed out live in the contact cache, which is LRU, so they stay valid
+  //   across fewer than CONTACT_CACHE_SIZE other lookups. Each lookup fetches at most one contact, but the scans
+  //   (scanRecentContacts(), searchContactsByPrefix(), ContactsIterator) can fetch many, so don't hold one across
+  //   those, or between loop() calls. To remember a contact for longer, keep its pub_key and look it up again.
   mesh::Packet* createSelfAdvert(const char* name);
   mesh::Packet* createSelfAdvert(const char* name, double lat, double lon);
   int  sendMessage(const ContactInfo& recipient, uint32_t timestamp, uint8_t attempt, const char* text, uint32_t& expected_ack, uint32_t& est_timeout);
@@ -156,12 +253,14 @@ public:
   bool importContact(const uint8_t src_buf[], uint8_t len);
   void resetPathTo(ContactInfo& recipient);
   void scanRecentContacts(int last_n, ContactVisitor* visitor);
-  ContactInfo* searchContactsByPrefix(const char* name_prefix);
+  ContactInfo* searchContactsByPrefix(const char* name_prefix);   // first match, in name order
+  int searchContactsByPrefix(const char* name_prefix, ContactVisitor* visitor, int max_results=0);  // returns num visited
   ContactInfo* lookupContactByPubKey(const uint8_t* pub_key, int prefix_len);
   bool  removeContact(ContactInfo& contact);
   bool  addContact(const ContactInfo& contact);
   int getNumContacts() const { return num_contacts; }
   bool getContactByIdx(uint32_t idx, ContactInfo& contact);
+  uint32_t getContactLastMod(uint32_t idx) const;   // NOTE: doesn't page in contact
   ContactsIterator startContactsIterator();
   ChannelDetails* addChannel(const char* name, const char* psk_base64);
   bool getChannel(int idx, ChannelDetails& dest);
@@ -169,4 +268,5 @@ public:
   int findChannelIdx(const mesh::GroupChannel& ch);
 
   void loop();
+  uint32_t getNumSecretsPrecomputed() const { return num_secrets_precomputed; }
 };
@@ -1,4 +1,5 @@
 #include "ClientACL.h"
+#include <helpers/RecordHelpers.h>
 
 static File openWrite(FILESYSTEM* _fs, const char* filename) {
   #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
@@ -11,40 +12,53 @@ static File openWrite(FILESYSTEM* _fs, const char* filename) {
   #endif
 }
 
-void ClientACL::load(FILESYSTEM* fs, const mesh::LocalIdentity& self_id) {
-  _fs = fs;
-  num_clients = 0;
-  if (_fs->exists("/s_contacts")) {
+#define ACL_REC_SIZE          140   // size of each record in /s_contacts2
+#define ACL_LEGACY_REC_SIZE   136   //   ... and in /s_contacts, which had no identity fingerprint
+
+static uint8_t io_block[4 * ACL_REC_SIZE];   // for reading/writing several records per file op
+
+static uint32_t calcIdentityFingerprint(const mesh::LocalIdentity& self_id) {
+  uint8_t hash[4];
+  mesh::Utils::sha256(hash, sizeof(hash), self_id.pub_key, PUB_KEY_SIZE);
+  uint32_t fp = readLE32(hash);
+  return fp == 0 ? 1 : fp;   // 0 is reserved, for records with no fingerprint
+}
+
+static File openRead(FILESYSTEM* _fs, const char* filename) {
   #if defined(RP2040_PLATFORM)
-    File file = _fs->open("/s_contacts", "r");
+    return _fs->open(filename, "r");
   #else
-    File file = _fs->open("/s_contacts");
+    return _fs->open(filename);
   #endif
-    if (file) {
-      bool full = false;
-      while (!full) {
-        ClientInfo c;
-        uint8_t pub_key[32];
-        uint8_t unused[2];
-
-        memset(&c, 0, sizeof(c));
+}
 
-        bool success = (file.read(pub_key, 32) == 32);
-        success = success && (file.read((uint8_t *) &c.permissions, 1) == 1);
-        success = success && (file.read((uint8_t *) &c.extra.room.sync_since, 4) == 4);
-        success = success && (file.read(unused, 2) == 2);
-        success = success && (file.read((uint8_t *)&c.out_path_len, 1) == 1);
-        success = success && (file.read(c.out_path, 64) == 64);
-        success = success && (file.read(c.shared_secret, PUB_KEY_SIZE) == PUB_KEY_SIZE); // will be recalculated below
+void ClientACL::load(FILESYSTEM* fs, const mesh::LocalIdentity& self_id) {
+  _fs = fs;
+  num_clients = 0;
+  _id_fingerprint = calcIdentityFingerprint(self_id);
 
-        if (!success) break; // EOF
+  bool legacy = !_fs->exists("/s_contacts2");   // not yet re-saved in new format?
+  const char* filename = legacy ? "/s_contacts" : "/s_contacts2";
+  if (_fs->exists(filename)) {
+    File file = openRead(_fs, filename);
+    if (file) {
+      BlockRecordReader rd(file, io_block, sizeof(io_block), legacy ? ACL_LEGACY_REC_SIZE : ACL_REC_SIZE);
+      const uint8_t* rec;
+      while (num_clients < MAX_CLIENTS && (rec = rd.next()) != NULL) {
+        ClientInfo& c = clients[num_clients++];
+        memset(&c, 0, sizeof(c));
 
-        c.id = mesh::Identity(pub_key);
-        self_id.calcSharedSecret(c.shared_secret, pub_key);  // recalculate shared secrets in case our private key changed
-        if (num_clients < MAX_CLIENTS) {
-          clients[num_clients++] = c;
+        c.id = mesh::Identity(&rec[0]);
+        c.permissions = rec[32];
+        c.extra.room.sync_since = readLE32(&rec[33]);
+        // rec[37..38] unused
+        c.out_path_len = (int8_t) rec[39];
+        memcpy(c.out_path, &rec[40], 64);
+        uint32_t fp = legacy ? 0 : readLE32(&rec[136]);   // fingerprint of our identity, when saved
+        if (fp == _id_fingerprint) {
+          memcpy(c.shared_secret, &rec[104], PUB_KEY_SIZE);
         } else {
-          full = true;
+          self_id.calcSharedSecret(c.shared_secret, c.id.pub_key);   // our private key may have changed, need to recalculate
         }
       }
       file.close();
@@ -54,26 +68,35 @@ void ClientACL::load(FILESYSTEM* fs, const mesh::LocalIdentity& self_id) {
 
 void ClientACL::save(FILESYSTEM* fs, bool (*filter)(ClientInfo*)) {
   _fs = fs;
-  File file = openWrite(_fs, "/s_contacts");
+  File file = openWrite(_fs, "/s_contacts2");
   if (file) {
-    uint8_t unused[2];
-    memset(unused, 0, sizeof(unused));
-
+    int len = 0;   // bytes pending in io_block[]
+    bool success = true;
     for (int i = 0; i < num_clients; i++) {
       auto c = &clients[i];
       if (c->permissions == 0 || (filter && !filter(c))) continue;    // skip deleted entries, or by filter function
 
-      bool success = (file.write(c->id.pub_key, 32) == 32);
-      success = success && (file.write((uint8_t *) &c->permissions, 1) == 1);
-      success = success && (file.write((uint8_t *) &c->extra.room.sync_since, 4) == 4);
-      success = success && (file.write(unused, 2) == 2);
-      success = success && (file.write((uint8_t *)&c->out_path_len, 1) == 1);
-      success = success && (file.write(c->out_path, 64) == 64);
-      success = success && (file.write(c->shared_secret, PUB_KEY_SIZE) == PUB_KEY_SIZE);
-
-      if (!success) break; // write failed
+      uint8_t* rec = &io_block[len];
+      memset(rec, 0, ACL_REC_SIZE);
+      memcpy(&rec[0], c->id.pub_key, 32);
+      rec[32] = c->permissions;
+      writeLE32(&rec[33], c->extra.room.sync_since);
+      rec[39] = (uint8_t) c->out_path_len;
+      memcpy(&rec[40], c->out_path, 64);
+      memcpy(&rec[104], c->shared_secret, PUB_KEY_SIZE);
+      writeLE32(&rec[136], _id_fingerprint);
+      len += ACL_REC_SIZE;
+
+      if (len + ACL_REC_SIZE > sizeof(io_block)) {
+        success = file.write(io_block, len) == len;
+        len = 0;
+        if (!success) break;  // write failed
+      }
     }
+    if (len > 0) success = file.write(io_block, len) == len;
     file.close();
+
+    if (success && _fs->exists("/s_contacts")) _fs->remove("/s_contacts");   // migrated
   }
 }
 
@@ -82,6 +105,9 @@ bool ClientACL::clear() {
   if (_fs->exists("/s_contacts")) {
     _fs->remove("/s_contacts");
   }
+  if (_fs->exists("/s_contacts2")) {
+    _fs->remove("/s_contacts2");
+  }
   memset(clients, 0, sizeof(clients));
   num_clients = 0;
   return true;
@@ -21,10 +21,7 @@ struct ClientInfo {
   union  {
     struct {
       uint32_t sync_since;  // sync messages SINCE this timestamp (by OUR clock)
-      uint32_t pending_ack;
-      uint32_t push_post_timestamp;
-      unsigned long ack_timeout;
-      uint8_t  push_failures;
+      uint32_t sync_seq;    // cursor: seq of oldest post not yet ACKed, 0 = derive from sync_since  (transient)
     } room;
   } extra;
   
@@ -39,11 +36,13 @@ class ClientACL {
   FILESYSTEM* _fs;
   ClientInfo clients[MAX_CLIENTS];
   int num_clients;
+  uint32_t _id_fingerprint;   // of our identity, saved with each client so shared_secret can be trusted at load
 
 public:
   ClientACL() { 
     memset(clients, 0, sizeof(clients));
     num_clients = 0;
+    _id_fingerprint = 0;
   }
   void load(FILESYSTEM* _fs, const mesh::LocalIdentity& self_id);
   void save(FILESYSTEM* _fs, bool (*filter)(ClientInfo*)=NULL);
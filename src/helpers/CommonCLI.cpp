@@ -91,7 +91,12 @@ void CommonCLI::loadPrefsInt(FILESYSTEM* fs, const char* filename) {
     file.read((uint8_t *)_prefs->mqtt_pass, sizeof(_prefs->mqtt_pass));            // 488
     file.read((uint8_t *)&_prefs->mqtt_autostart, sizeof(_prefs->mqtt_autostart)); // 521
     file.read((uint8_t *)&_prefs->mqtt_banned,    sizeof(_prefs->mqtt_banned));    // 522
-    // 523
+    file.read((uint8_t *)&_prefs->flood_src_rate, sizeof(_prefs->flood_src_rate));   // 523
+    file.read((uint8_t *)&_prefs->flood_src_burst, sizeof(_prefs->flood_src_burst)); // 524
+    file.read((uint8_t *)&_prefs->gossip_prob, sizeof(_prefs->gossip_prob));         // 525
+    file.read((uint8_t *)&_prefs->gossip_hops, sizeof(_prefs->gossip_hops));         // 526
+    file.read((uint8_t *)&_prefs->gossip_dups, sizeof(_prefs->gossip_dups));         // 527
+    // 528
 
     // sanitise bad pref values
     _prefs->rx_delay_base = constrain(_prefs->rx_delay_base, 0, 20.0f);
@@ -121,6 +126,7 @@ void CommonCLI::loadPrefsInt(FILESYSTEM* fs, const char* filename) {
 
     _prefs->gps_enabled = constrain(_prefs->gps_enabled, 0, 1);
     _prefs->advert_loc_policy = constrain(_prefs->advert_loc_policy, 0, 2);
+    _prefs->gossip_prob = constrain(_prefs->gossip_prob, 1, 100);
 
     file.close();
   }
@@ -189,7 +195,12 @@ void CommonCLI::savePrefs(FILESYSTEM* fs) {
     file.write((uint8_t *)_prefs->mqtt_pass, sizeof(_prefs->mqtt_pass));            // 488
     file.write((uint8_t *)&_prefs->mqtt_autostart, sizeof(_prefs->mqtt_autostart)); // 521
     file.write((uint8_t *)&_prefs->mqtt_banned,    sizeof(_prefs->mqtt_banned));    // 522
-    // 523
+    file.write((uint8_t *)&_prefs->flood_src_rate, sizeof(_prefs->flood_src_rate));   // 523
+    file.write((uint8_t *)&_prefs->flood_src_burst, sizeof(_prefs->flood_src_burst)); // 524
+    file.write((uint8_t *)&_prefs->gossip_prob, sizeof(_prefs->gossip_prob));         // 525
+    file.write((uint8_t *)&_prefs->gossip_hops, sizeof(_prefs->gossip_hops));         // 526
+    file.write((uint8_t *)&_prefs->gossip_dups, sizeof(_prefs->gossip_dups));         // 527
+    // 528
 
     file.close();
   }
@@ -338,6 +349,10 @@ void CommonCLI::handleCommand(uint32_t sender_timestamp, const char* command, ch
         sprintf(reply, "> %s", StrHelper::ftoa(_prefs->tx_delay_factor));
       } else if (memcmp(config, "flood.max", 9) == 0) {
         sprintf(reply, "> %d", (uint32_t)_prefs->flood_max);
+      } else if (memcmp(config, "flood.rate", 10) == 0) {
+        sprintf(reply, "> %d,%d", (uint32_t)_prefs->flood_src_rate, (uint32_t)_prefs->flood_src_burst);
+      } else if (memcmp(config, "gossip", 6) == 0) {
+        sprintf(reply, "> %d,%d,%d", (uint32_t)_prefs->gossip_prob, (uint32_t)_prefs->gossip_hops, (uint32_t)_prefs->gossip_dups);
       } else if (memcmp(config, "direct.txdelay", 14) == 0) {
         sprintf(reply, "> %s", StrHelper::ftoa(_prefs->direct_tx_delay_factor));
       } else if (memcmp(config, "owner.info", 10) == 0) {
@@ -571,6 +586,33 @@ void CommonCLI::handleCommand(uint32_t sender_timestamp, const char* command, ch
         } else {
           strcpy(reply, "Error, max 64");
         }
+      } else if (memcmp(config, "flood.rate ", 11) == 0) {
+        int rate = atoi(&config[11]);
+        const char* sp = strchr(&config[11], ',');
+        int burst = sp ? atoi(sp + 1) : _prefs->flood_src_burst;
+        if (rate >= 0 && rate <= 255 && burst >= 1 && burst <= 255) {
+          _prefs->flood_src_rate = rate;
+          _prefs->flood_src_burst = burst;
+          savePrefs();
+          strcpy(reply, "OK");
+        } else {
+          strcpy(reply, "Error, range is 0-255[,1-255]");
+        }
+      } else if (memcmp(config, "gossip ", 7) == 0) {
+        int prob = atoi(&config[7]);
+        const char* sp = strchr(&config[7], ',');
+        int hops = sp ? atoi(sp + 1) : _prefs->gossip_hops;
+        if (sp) sp = strchr(sp + 1, ',');
+        int dups = sp ? atoi(sp + 1) : _prefs->gossip_dups;
+        if (prob >= 1 && prob <= 100 && hops >= 0 && hops <= 64 && dups >= 0 && dups <= 16) {
+          _prefs->gossip_prob = prob;
+          _prefs->gossip_hops = hops;
+          _prefs->gossip_dups = dups;
+          savePrefs();
+          strcpy(reply, "OK");
+        } else {
+          strcpy(reply, "Error, range is 1-100[,0-64[,0-16]]");
+        }
       } else if (memcmp(config, "direct.txdelay ", 15) == 0) {
         float f = atof(&config[15]);
         if (f >= 0) {
@@ -855,6 +897,9 @@ void CommonCLI::handleCommand(uint32_t sender_timestamp, const char* command, ch
     } else if (memcmp(command, "log erase", 9) == 0) {
       _callbacks->eraseLogFile();
       strcpy(reply, "   log erased");
+    } else if (sender_timestamp == 0 && memcmp(command, "log pcap", 8) == 0) {
+      _callbacks->dumpCaptureFile();
+      strcpy(reply, "   EOF");
     } else if (sender_timestamp == 0 && memcmp(command, "log", 3) == 0) {
       _callbacks->dumpLogFile();
       strcpy(reply, "   EOF");
@@ -921,6 +966,7 @@ void CommonCLI::handleCommand(uint32_t sender_timestamp, const char* command, ch
       Serial.println("set <key> <value>         write a config value");
       Serial.println("erase                     erase filesystem (serial only)");
       Serial.println("log                       dump log (serial only)");
+      Serial.println("log pcap                  dump pcapng capture (serial only)");
       Serial.println("log off                   stop logging");
       Serial.println("log erase                 erase log file");
       Serial.println("stats-packets             packet statistics (serial only)");
@@ -65,6 +65,13 @@ struct NodePrefs { // persisted to file
   // offset 522
   uint8_t mqtt_banned;     // 1 = node was banned from public bridge;
   // offset 523
+  uint8_t flood_src_rate;  // flood packets per minute, per source (0 = no limit)
+  uint8_t flood_src_burst;
+  // offset 525
+  uint8_t gossip_prob;     // percent, for regions with gossip enabled
+  uint8_t gossip_hops;     // always forward below this many hops
+  uint8_t gossip_dups;     // cancel queued forward after hearing this many duplicates (0 = never)
+  // offset 528
 };
 
 class CommonCLICallbacks {
@@ -80,6 +87,9 @@ public:
   virtual void setLoggingOn(bool enable) = 0;
   virtual void eraseLogFile() = 0;
   virtual void dumpLogFile() = 0;
+  virtual void dumpCaptureFile() {
+    // no op by default (only for builds WITH_PCAP_CAPTURE)
+  };
   virtual void setTxPower(int8_t power_dbm) = 0;
   virtual void formatNeighborsReply(char *reply) = 0;
   virtual void removeNeighbor(const uint8_t* pubkey, int key_len) {
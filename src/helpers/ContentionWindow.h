@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifndef TX_WINDOW_MIN_SCALE
+  #define TX_WINDOW_MIN_SCALE       0.1f
+#endif
+#ifndef TX_WINDOW_MAX_SCALE
+  #define TX_WINDOW_MAX_SCALE       3.0f
+#endif
+#ifndef TX_WINDOW_REF_NEIGHBOURS
+  #define TX_WINDOW_REF_NEIGHBOURS     4    // at this density (and ~50% duplicates), window is unscaled
+#endif
+#define TX_WINDOW_MIN_SAMPLES          8    // flood packets per update, before duplicate rate is re-estimated
+
+/**
+ * \brief  scales the flood retransmit (contention) window, from the number of active neighbours and the rate
+ *         of duplicate floods heard. Wider when many neighbours are forwarding the same packets, narrower
+ *         toward zero on sparse links.
+ */
+class ContentionWindow {
+  float _scale;
+  uint32_t _last_recv, _last_dups;
+  int _neighbours;      // -1 = unknown
+  uint8_t _dup_pct;
+
+public:
+  ContentionWindow() : _scale(1.0f), _last_recv(0), _last_dups(0), _neighbours(-1), _dup_pct(50) { }
+
+  /**
+   * \param  active_neighbours  recently heard neighbours, or -1 if not known
+   * \param  num_recv_flood, num_flood_dups  running totals
+   */
+  void update(int active_neighbours, uint32_t num_recv_flood, uint32_t num_flood_dups) {
+    uint32_t recv = num_recv_flood - _last_recv, dups = num_flood_dups - _last_dups;
+    if (recv >= TX_WINDOW_MIN_SAMPLES) {
+      _dup_pct = dups >= recv ? 100 : (dups * 100) / recv;
+      _last_recv = num_recv_flood;
+      _last_dups = num_flood_dups;
+    }
+    _neighbours = active_neighbours;
+
+    float density = active_neighbours < 0 ? 1.0f : (active_neighbours + 1) / (float)(TX_WINDOW_REF_NEIGHBOURS + 1);
+    float target = density * (0.5f + _dup_pct / 100.0f);
+    if (target < TX_WINDOW_MIN_SCALE) target = TX_WINDOW_MIN_SCALE;
+    if (target > TX_WINDOW_MAX_SCALE) target = TX_WINDOW_MAX_SCALE;
+    _scale += (target - _scale) * 0.25f;   // smooth out changes
+  }
+
+  float getScale() const { return _scale; }
+  int getNeighbours() const { return _neighbours; }
+  int getDupPercent() const { return _dup_pct; }
+};
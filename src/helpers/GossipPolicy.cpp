@@ -0,0 +1,67 @@
+#include "GossipPolicy.h"
+
+bool GossipPolicy::shouldForward(const mesh::Packet* pkt, float snr, int active_neighbours, uint8_t prob_pct, uint8_t min_hops, mesh::RNG* rng) {
+  if (pkt->path_len < min_hops || prob_pct >= 100) {
+    _n_forwarded++;
+    return true;
+  }
+
+  float p = prob_pct / 100.0f;
+  if (active_neighbours > GOSSIP_REF_NEIGHBOURS) {   // keep expected number of forwarders about the same
+    p *= (GOSSIP_REF_NEIGHBOURS + 1) / (float)(active_neighbours + 1);
+  }
+  float f = 1.0f + (GOSSIP_SNR_REF - snr) / 20.0f;
+  if (f < 0.5f) f = 0.5f;
+  if (f > 1.5f) f = 1.5f;
+  p *= f;
+
+  if (rng->nextInt(0, 1000) < (int)(p * 1000)) {
+    _n_forwarded++;
+    return true;
+  }
+  _n_skipped++;
+  return false;
+}
+
+void GossipPolicy::onQueued(const mesh::Packet* pkt) {
+  uint8_t hash[MAX_HASH_SIZE];
+  pkt->calculatePacketHash(hash);
+
+  auto p = &_pending[_next_pending];   // NOTE: overwrites oldest
+  p->pkt = pkt;
+  memcpy(&p->pkt_hash, hash, 4);
+  p->dups = 0;
+  _next_pending = (_next_pending + 1) % GOSSIP_MAX_PENDING;
+}
+
+const mesh::Packet* GossipPolicy::onHeard(const mesh::Packet* pkt, uint8_t max_dups) {
+  if (max_dups == 0) return NULL;
+
+  bool any = false;
+  for (int i = 0; i < GOSSIP_MAX_PENDING; i++) {
+    if (_pending[i].pkt) { any = true; break; }
+  }
+  if (!any) return NULL;   // avoid calculating hash
+
+  uint8_t hash[MAX_HASH_SIZE];
+  pkt->calculatePacketHash(hash);
+  uint32_t h;
+  memcpy(&h, hash, 4);
+  for (int i = 0; i < GOSSIP_MAX_PENDING; i++) {
+    auto p = &_pending[i];
+    if (p->pkt && p->pkt != pkt && p->pkt_hash == h) {
+      if (++p->dups < max_dups) return NULL;
+
+      const mesh::Packet* queued = p->pkt;
+      p->pkt = NULL;
+      return queued;
+    }
+  }
+  return NULL;
+}
+
+void GossipPolicy::onSent(const mesh::Packet* pkt) {
+  for (int i = 0; i < GOSSIP_MAX_PENDING; i++) {
+    if (_pending[i].pkt == pkt) _pending[i].pkt = NULL;   // too late to cancel, and instance will be re-used
+  }
+}
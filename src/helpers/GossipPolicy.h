@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Mesh.h>
+
+#ifndef GOSSIP_MAX_PENDING
+  #define GOSSIP_MAX_PENDING    8    // queued floods, being watched for duplicates
+#endif
+#define GOSSIP_REF_NEIGHBOURS   4    // above this density, forward probability is reduced
+#define GOSSIP_SNR_REF          5.0f // dB, link SNR at which forward probability is unscaled
+
+/**
+ * \brief  probabilistic ('gossip') flood forwarding, for dense clusters of repeaters. GOSSIP1(p, k): always
+ *         forward in the first k hops, then with probability p, scaled by neighbour density and SNR (weak
+ *         links are more likely to reach new nodes). Forwards that are queued are then cancelled if enough
+ *         duplicates are heard from other repeaters before our turn to transmit.
+ */
+class GossipPolicy {
+  struct Pending {
+    const mesh::Packet* pkt;    // NULL = unused
+    uint32_t pkt_hash;          // first 4 bytes of packet hash
+    uint8_t dups;
+  };
+
+  Pending _pending[GOSSIP_MAX_PENDING];
+  int _next_pending;
+  uint32_t _n_forwarded, _n_skipped, _n_cancelled;
+
+public:
+  GossipPolicy() { memset(_pending, 0, sizeof(_pending)); _next_pending = 0; resetStats(); }
+
+  /**
+   * \param  prob_pct  p, as percent
+   * \param  min_hops  k
+   * \param  active_neighbours  or -1 if not known
+   */
+  bool shouldForward(const mesh::Packet* pkt, float snr, int active_neighbours, uint8_t prob_pct, uint8_t min_hops, mesh::RNG* rng);
+
+  /**
+   * \brief  watch this (about to be queued) packet for duplicates
+   */
+  void onQueued(const mesh::Packet* pkt);
+
+  /**
+   * \brief  a flood packet was received
+   * \returns  the queued packet to be cancelled, if it has now been heard from 'max_dups' others, else NULL
+   */
+  const mesh::Packet* onHeard(const mesh::Packet* pkt, uint8_t max_dups);
+
+  /**
+   * \brief  packet was sent, OR failed to send. Either way, instance is about to be released (and re-used)
+   */
+  void onSent(const mesh::Packet* pkt);
+
+  void onCancelled() { _n_cancelled++; }
+
+  uint32_t getNumForwarded() const { return _n_forwarded; }
+  uint32_t getNumSkipped() const { return _n_skipped; }
+  uint32_t getNumCancelled() const { return _n_cancelled; }
+  void resetStats() { _n_forwarded = _n_skipped = _n_cancelled = 0; }
+};
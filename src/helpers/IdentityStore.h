@@ -8,6 +8,9 @@
   #define FILESYSTEM  Adafruit_LittleFS
 
   using namespace Adafruit_LittleFS_Namespace;
+#elif defined(POSIX_PLATFORM)
+  #include <helpers/posix/PosixFileSystem.h>
+  #define FILESYSTEM  PosixFS
 #endif
 #include <Identity.h>
 
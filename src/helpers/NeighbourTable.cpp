@@ -0,0 +1,198 @@
+#include "NeighbourTable.h"
+#include <helpers/RecordHelpers.h>
+
+#define EWMA_SHIFT   3    // new sample weighted 1/8
+
+static int16_t ewma(int16_t avg, int16_t sample) {
+  return avg + ((sample - avg + (1 << (EWMA_SHIFT - 1))) >> EWMA_SHIFT);   // rounded, so doesn't settle low
+}
+
+NeighbourTable::NeighbourTable(NeighbourInfo entries[], int max_entries) : _entries(entries), _max(max_entries) {
+  if (_max > 255) _max = 255;   // indexes must fit uint8_t
+  clear();
+}
+
+void NeighbourTable::clear() {
+  memset(_entries, 0, sizeof(NeighbourInfo) * _max);
+  memset(_buckets, 0, sizeof(_buckets));
+  memset(_pending, 0, sizeof(_pending));
+  _next_pending = 0;
+}
+
+void NeighbourTable::unlink(int idx) {
+  uint8_t* link = &_buckets[_entries[idx].id.pub_key[0] & (NEIGHBOUR_HASH_BUCKETS - 1)];
+  while (*link) {
+    if (*link == idx + 1) {
+      *link = _entries[idx].next;
+      break;
+    }
+    link = &_entries[*link - 1].next;
+  }
+  _entries[idx].next = 0;
+}
+
+void NeighbourTable::updateStats(NeighbourInfo* n, float snr, float rssi) {
+  int16_t s = (int16_t)(snr * 16), r = (int16_t)(rssi * 16);
+  if (n->num_heard == 0) {
+    n->snr_avg = s;
+    n->rssi_avg = r;
+  } else {
+    n->snr_avg = ewma(n->snr_avg, s);
+    n->rssi_avg = ewma(n->rssi_avg, r);
+  }
+  n->snr = (int8_t)(snr * 4);
+  if (n->num_heard < 0xFFFF) n->num_heard++;
+}
+
+NeighbourInfo* NeighbourTable::find(const uint8_t* pub_key, int key_len) {
+  uint8_t i = _buckets[pub_key[0] & (NEIGHBOUR_HASH_BUCKETS - 1)];
+  while (i) {
+    auto n = &_entries[i - 1];
+    if (memcmp(n->id.pub_key, pub_key, key_len) == 0) return n;
+    i = n->next;
+  }
+  return NULL;
+}
+
+NeighbourInfo* NeighbourTable::findByHash(uint8_t hash) {
+  NeighbourInfo* found = NULL;
+  uint8_t i = _buckets[hash & (NEIGHBOUR_HASH_BUCKETS - 1)];
+  while (i) {
+    auto n = &_entries[i - 1];
+    if (n->id.pub_key[0] == hash) {
+      if (found) return NULL;   // ambiguous
+      found = n;
+    }
+    i = n->next;
+  }
+  return found;
+}
+
+NeighbourInfo* NeighbourTable::put(const mesh::Identity& id, uint32_t advert_timestamp, uint32_t now, float snr, float rssi) {
+  if (_max == 0) return NULL;
+
+  NeighbourInfo* n = find(id.pub_key, PUB_KEY_SIZE);
+  if (n == NULL) {
+    // use a free entry, else evict least recently heard
+    int idx = 0;
+    for (int i = 0; i < _max; i++) {
+      if (_entries[i].heard_timestamp == 0) {
+        idx = i;
+        break;
+      }
+      if (_entries[i].heard_timestamp < _entries[idx].heard_timestamp) idx = i;
+    }
+    if (_entries[idx].heard_timestamp) unlink(idx);
+
+    n = &_entries[idx];
+    memset(n, 0, sizeof(*n));
+    n->id = id;
+    uint8_t* head = &_buckets[id.pub_key[0] & (NEIGHBOUR_HASH_BUCKETS - 1)];
+    n->next = *head;
+    *head = idx + 1;
+  }
+  n->advert_timestamp = advert_timestamp;
+  n->heard_timestamp = now;
+  updateStats(n, snr, rssi);
+  return n;
+}
+
+void NeighbourTable::onHeard(uint8_t hash, uint32_t now, float snr, float rssi) {
+  NeighbourInfo* n = findByHash(hash);
+  if (n) {
+    n->heard_timestamp = now;
+    updateStats(n, snr, rssi);
+  }
+}
+
+void NeighbourTable::onDirectSent(const mesh::Packet* pkt, unsigned long now_millis) {
+  if (pkt->path_len == 0) return;   // to final destination, which won't pass it on
+
+  NeighbourInfo* n = findByHash(pkt->path[0]);
+  if (n == NULL) return;
+
+  uint8_t hash[MAX_HASH_SIZE];
+  pkt->calculatePacketHash(hash);
+
+  auto p = &_pending[_next_pending];   // NOTE: overwrites oldest
+  p->pkt_hash = readLE32(hash);
+  p->next_hop = pkt->path[0];
+  p->sent_at = now_millis ? now_millis : 1;
+  _next_pending = (_next_pending + 1) % NEIGHBOUR_FWD_PENDING;
+
+  if (n->fwd_sent == 0xFFFF) {   // keep ratio, when saturated
+    n->fwd_sent >>= 1;
+    n->fwd_acked >>= 1;
+  }
+  n->fwd_sent++;
+}
+
+void NeighbourTable::onDirectRecv(const mesh::Packet* pkt) {
+  bool any = false;
+  for (int i = 0; i < NEIGHBOUR_FWD_PENDING; i++) {
+    if (_pending[i].sent_at) { any = true; break; }
+  }
+  if (!any) return;   // avoid calculating hash
+
+  uint8_t hash[MAX_HASH_SIZE];
+  pkt->calculatePacketHash(hash);
+  uint32_t h = readLE32(hash);
+  for (int i = 0; i < NEIGHBOUR_FWD_PENDING; i++) {
+    auto p = &_pending[i];
+    if (p->sent_at && p->pkt_hash == h) {
+      NeighbourInfo* n = findByHash(p->next_hop);
+      if (n && n->fwd_acked < n->fwd_sent) n->fwd_acked++;
+      p->sent_at = 0;
+      break;
+    }
+  }
+}
+
+void NeighbourTable::expireForwards(unsigned long now_millis) {
+  for (int i = 0; i < NEIGHBOUR_FWD_PENDING; i++) {
+    if (_pending[i].sent_at && now_millis - _pending[i].sent_at >= NEIGHBOUR_FWD_ACK_MILLIS) {
+      _pending[i].sent_at = 0;   // not heard passed on (already counted in fwd_sent)
+    }
+  }
+}
+
+int NeighbourTable::remove(const uint8_t* pub_key, int key_len) {
+  int n = 0;
+  for (int i = 0; i < _max; i++) {
+    if (_entries[i].heard_timestamp && memcmp(_entries[i].id.pub_key, pub_key, key_len) == 0) {
+      unlink(i);
+      memset(&_entries[i], 0, sizeof(_entries[i]));
+      n++;
+    }
+  }
+  return n;
+}
+
+int NeighbourTable::countActive(uint32_t since) const {
+  int n = 0;
+  for (int i = 0; i < _max; i++) {
+    if (_entries[i].heard_timestamp > 0 && _entries[i].heard_timestamp >= since) n++;
+  }
+  return n;
+}
+
+int NeighbourTable::getAll(NeighbourInfo* dest[]) const {
+  int n = 0;
+  for (int i = 0; i < _max; i++) {
+    if (_entries[i].heard_timestamp > 0) dest[n++] = &_entries[i];
+  }
+  return n;
+}
+
+int NeighbourTable::exportEntry(const NeighbourInfo& n, uint32_t now, uint8_t* dest) {
+  int i = 0;
+  memcpy(&dest[i], n.id.pub_key, 6); i += 6;
+  writeLE32(&dest[i], now - n.heard_timestamp); i += 4;
+  dest[i++] = (uint8_t) n.snr;
+  dest[i++] = (uint8_t)(int8_t)(n.snr_avg / 4);   // to SNR * 4
+  writeLE16(&dest[i], (uint16_t)(int16_t)(n.rssi_avg / 16)); i += 2;
+  writeLE16(&dest[i], n.num_heard); i += 2;
+  writeLE16(&dest[i], n.fwd_sent); i += 2;
+  writeLE16(&dest[i], n.fwd_acked); i += 2;
+  return i;
+}
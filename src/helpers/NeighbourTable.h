@@ -0,0 +1,101 @@
+#pragma once
+
+#include <Arduino.h>   // needed for PlatformIO
+#include <Mesh.h>
+
+#ifndef NEIGHBOUR_HASH_BUCKETS
+  #define NEIGHBOUR_HASH_BUCKETS    32    // must be power of 2
+#endif
+#ifndef NEIGHBOUR_FWD_PENDING
+  #define NEIGHBOUR_FWD_PENDING      8    // direct forwards waiting to be heard passed on
+#endif
+#ifndef NEIGHBOUR_FWD_ACK_MILLIS
+  #define NEIGHBOUR_FWD_ACK_MILLIS   8000
+#endif
+
+struct NeighbourInfo {
+  mesh::Identity id;
+  uint32_t advert_timestamp;   // by THEIR clock
+  uint32_t heard_timestamp;    // by OUR clock, 0 = unused entry
+  int8_t snr;        // last, multiplied by 4, user should divide to get float value
+  int16_t snr_avg;   // EWMA, multiplied by 16
+  int16_t rssi_avg;  // EWMA, multiplied by 16
+  uint16_t num_heard;    // packets heard from this neighbour (saturates)
+  uint16_t fwd_sent;     // direct packets we sent with this as next hop
+  uint16_t fwd_acked;    //   ... and then heard being passed on
+  uint8_t next;      // (index + 1) of next in same hash bucket, 0 = end
+
+  float getSNR() const { return snr_avg / 16.0f; }
+  float getRSSI() const { return rssi_avg / 16.0f; }
+};
+
+#define NEIGHBOUR_EXPORT_REC_SIZE   (6 + 4 + 1 + 1 + 2 + 2 + 2 + 2)
+
+/**
+ * \brief  table of neighbouring nodes (storage given by owner), with link statistics. Lookups are by
+ *         a small hash table, on first byte of pub_key (which is also the path hash).
+ */
+class NeighbourTable {
+  struct PendingFwd {
+    uint32_t pkt_hash;   // first 4 bytes of packet hash
+    unsigned long sent_at;   // 0 = unused
+    uint8_t next_hop;
+  };
+
+  NeighbourInfo* _entries;
+  int _max;
+  uint8_t _buckets[NEIGHBOUR_HASH_BUCKETS];   // (index + 1) of first in bucket
+  PendingFwd _pending[NEIGHBOUR_FWD_PENDING];
+  int _next_pending;
+
+  void unlink(int idx);
+  void updateStats(NeighbourInfo* n, float snr, float rssi);
+
+public:
+  NeighbourTable(NeighbourInfo entries[], int max_entries);
+
+  void clear();
+
+  /**
+   * \brief  add/update from a neighbour's (zero hop) advert. May evict least recently heard.
+   */
+  NeighbourInfo* put(const mesh::Identity& id, uint32_t advert_timestamp, uint32_t now, float snr, float rssi);
+
+  NeighbourInfo* find(const uint8_t* pub_key, int key_len);
+
+  /**
+   * \returns  the only neighbour with this path hash, or NULL if none (or ambiguous)
+   */
+  NeighbourInfo* findByHash(uint8_t hash);
+
+  /**
+   * \brief  a packet was received, relayed by neighbour with given path hash
+   */
+  void onHeard(uint8_t hash, uint32_t now, float snr, float rssi);
+
+  /**
+   * \brief  track a direct packet we have sent, to check next hop passes it on
+   */
+  void onDirectSent(const mesh::Packet* pkt, unsigned long now_millis);
+  void onDirectRecv(const mesh::Packet* pkt);
+  void expireForwards(unsigned long now_millis);
+
+  int remove(const uint8_t* pub_key, int key_len);
+
+  /**
+   * \returns  number of neighbours heard at/after 'since'
+   */
+  int countActive(uint32_t since) const;
+
+  /**
+   * \brief  fill 'dest' with pointers to all entries in use
+   * \returns  number of entries
+   */
+  int getAll(NeighbourInfo* dest[]) const;
+
+  /**
+   * \brief  binary export of one entry: pub_key prefix(6), secs since heard(4), last SNR*4(1), avg SNR*4(1),
+   *         avg RSSI(2), num heard(2), direct forwards(2), forwards heard passed on(2). All little-endian.
+   */
+  static int exportEntry(const NeighbourInfo& n, uint32_t now, uint8_t* dest);
+};
@@ -0,0 +1,138 @@
+#include "PacketLog.h"
+#include <RTClib.h>
+#include <helpers/RecordHelpers.h>
+
+/*
+  Record format (little-endian):
+    [0..3]  timestamp (by our RTC)
+    [4]     type (PKT_LOG_*)
+    [5]     packet header
+    [6]     len (raw)
+    [7]     payload_len
+    [8]     SNR (int8)
+    [9..10] RSSI (int16)
+    [11..12] score * 1000 (int16)
+    [13]    src hash
+    [14]    dest hash
+    [15]    flags
+*/
+#define REC_FLAG_HAS_HASHES   0x01
+
+File PacketLog::openAppend() {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  return _fs->open(_fname, FILE_O_WRITE);
+#elif defined(RP2040_PLATFORM)
+  return _fs->open(_fname, "a");
+#else
+  return _fs->open(_fname, "a", true);
+#endif
+}
+
+void PacketLog::add(uint8_t type, uint32_t timestamp, unsigned long now_millis, const mesh::Packet* pkt, int len,
+                    float snr, float rssi, float score) {
+  if (_count >= PACKET_LOG_BUF_RECS) {
+    flush();   // loop() hasn't had a chance to, so do it now
+  }
+  if (_count == 0) _oldest_millis = now_millis;
+
+  uint8_t* rec = &_buf[_count * PKT_LOG_REC_SIZE];
+  _count++;
+
+  writeLE32(&rec[0], timestamp);
+  rec[4] = type;
+  rec[5] = pkt->header;
+  rec[6] = len;
+  rec[7] = pkt->payload_len;
+  rec[8] = (int8_t) snr;
+  writeLE16(&rec[9], (int16_t) rssi);
+  writeLE16(&rec[11], (int16_t) (score * 1000));
+
+  uint8_t t = pkt->getPayloadType();
+  if (t == PAYLOAD_TYPE_PATH || t == PAYLOAD_TYPE_REQ || t == PAYLOAD_TYPE_RESPONSE || t == PAYLOAD_TYPE_TXT_MSG) {
+    rec[13] = pkt->payload[1];
+    rec[14] = pkt->payload[0];
+    rec[15] = REC_FLAG_HAS_HASHES;
+  } else {
+    rec[13] = rec[14] = 0;
+    rec[15] = 0;
+  }
+}
+
+void PacketLog::loop(unsigned long now_millis) {
+  if (_count > 0 && (_count >= PACKET_LOG_FLUSH_RECS || now_millis - _oldest_millis >= PACKET_LOG_FLUSH_MILLIS)) {
+    flush();
+  }
+}
+
+bool PacketLog::flush() {
+  if (_count == 0) return true;
+
+  bool success = false;
+  File f;
+  if (_fs) f = openAppend();
+  if (f) {
+    success = f.write(_buf, _count * PKT_LOG_REC_SIZE) == _count * PKT_LOG_REC_SIZE;
+    f.close();
+  }
+  if (!success) _num_dropped += _count;   // don't keep retrying, from every loop()
+
+  _count = 0;
+  return success;
+}
+
+void PacketLog::erase() {
+  _count = 0;
+  if (_fs) _fs->remove(_fname);
+}
+
+static void formatDateTime(char* dest, uint32_t timestamp) {
+  DateTime dt = DateTime(timestamp);
+  sprintf(dest, "%02d:%02d:%02d - %d/%d/%d U", dt.hour(), dt.minute(), dt.second(), dt.day(), dt.month(),
+          dt.year());
+}
+
+void PacketLog::dump(Stream& out) {
+  flush();
+  if (_fs == NULL) return;
+
+#if defined(RP2040_PLATFORM)
+  File f = _fs->open(_fname, "r");
+#else
+  File f = _fs->open(_fname);
+#endif
+  if (f) {
+    uint8_t block[8 * PKT_LOG_REC_SIZE];
+    BlockRecordReader reader(f, block, sizeof(block), PKT_LOG_REC_SIZE);
+    const uint8_t* rec;
+    char line[140];
+    while ((rec = reader.next()) != NULL) {
+      char* dp = line;
+      formatDateTime(dp, readLE32(&rec[0]));
+      dp += strlen(dp);
+
+      uint8_t header = rec[5];
+      uint8_t route = header & PH_ROUTE_MASK;
+      const char* route_str = (route == ROUTE_TYPE_DIRECT || route == ROUTE_TYPE_TRANSPORT_DIRECT) ? "D" : "F";
+      int payload_type = (header >> PH_TYPE_SHIFT) & PH_TYPE_MASK;
+
+      if (rec[4] == PKT_LOG_RX) {
+        dp += sprintf(dp, ": RX, len=%d (type=%d, route=%s, payload_len=%d) SNR=%d RSSI=%d score=%d", (int)rec[6],
+                      payload_type, route_str, (int)rec[7], (int)(int8_t)rec[8], (int)(int16_t)readLE16(&rec[9]),
+                      (int)(int16_t)readLE16(&rec[11]));
+      } else if (rec[4] == PKT_LOG_TX) {
+        dp += sprintf(dp, ": TX, len=%d (type=%d, route=%s, payload_len=%d)", (int)rec[6], payload_type, route_str,
+                      (int)rec[7]);
+      } else {
+        dp += sprintf(dp, ": TX FAIL!, len=%d (type=%d, route=%s, payload_len=%d)", (int)rec[6], payload_type,
+                      route_str, (int)rec[7]);
+      }
+      if (rec[4] != PKT_LOG_TX_FAIL && (rec[15] & REC_FLAG_HAS_HASHES)) {
+        sprintf(dp, " [%02X -> %02X]\n", (uint32_t)rec[13], (uint32_t)rec[14]);
+      } else {
+        strcpy(dp, "\n");
+      }
+      out.print(line);
+    }
+    f.close();
+  }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Arduino.h>   // needed for PlatformIO
+#include <Packet.h>
+#include <helpers/IdentityStore.h>
+
+#define PKT_LOG_RX        0
+#define PKT_LOG_TX        1
+#define PKT_LOG_TX_FAIL   2
+
+#define PKT_LOG_REC_SIZE  16   // size of each (binary) record in log file
+
+#ifndef PACKET_LOG_BUF_RECS
+  #define PACKET_LOG_BUF_RECS      32
+#endif
+#ifndef PACKET_LOG_FLUSH_RECS
+  #define PACKET_LOG_FLUSH_RECS    (PACKET_LOG_BUF_RECS*3/4)   // watermark
+#endif
+#ifndef PACKET_LOG_FLUSH_MILLIS
+  #define PACKET_LOG_FLUSH_MILLIS  60000    // max time a record sits in RAM
+#endif
+
+/**
+ * \brief  packet log, as compact binary records buffered in RAM and appended to a file in batches.
+ *         Text is only rendered on demand, by dump().
+ */
+class PacketLog {
+  FILESYSTEM* _fs;
+  const char* _fname;
+  uint8_t _buf[PACKET_LOG_BUF_RECS * PKT_LOG_REC_SIZE];   // encoded records, oldest first. Emptied by flush()
+  int _count;
+  unsigned long _oldest_millis;   // when the oldest buffered record was added
+  uint32_t _num_dropped;
+
+  File openAppend();
+
+public:
+  PacketLog(const char* fname) : _fs(NULL), _fname(fname), _count(0), _oldest_millis(0), _num_dropped(0) { }
+
+  void begin(FILESYSTEM* fs) { _fs = fs; }
+
+  /**
+   * \param  timestamp  by our RTC clock
+   * \param  now_millis  for scheduling the flush
+   */
+  void add(uint8_t type, uint32_t timestamp, unsigned long now_millis, const mesh::Packet* pkt, int len,
+           float snr=0, float rssi=0, float score=0);
+
+  /**
+   * \brief  call from main loop(). Flushes to file when watermark is reached, or records have aged.
+   */
+  void loop(unsigned long now_millis);
+
+  bool flush();
+  void erase();
+  void dump(Stream& out);   // flushes, then renders whole file as text
+
+  int getNumBuffered() const { return _count; }
+  uint32_t getNumDropped() const { return _num_dropped; }
+};
@@ -0,0 +1,136 @@
+#include "PathCandidates.h"
+
+PathCandidates::Entry* PathCandidates::find(const uint8_t* pub_key) {
+  for (int i = 0; i < MAX_PATH_CANDIDATE_CONTACTS; i++) {
+    if (_entries[i].last_used && memcmp(_entries[i].pub_key, pub_key, sizeof(_entries[i].pub_key)) == 0) {
+      _entries[i].last_used = ++_use_counter;
+      return &_entries[i];
+    }
+  }
+  return NULL;
+}
+
+PathCandidate* PathCandidates::findPath(Entry* e, const uint8_t* path, uint8_t path_len) {
+  for (int i = 0; i < PATH_CANDIDATES_PER_CONTACT; i++) {
+    auto c = &e->cands[i];
+    if (c->heard && c->path_len == path_len && memcmp(c->path, path, path_len) == 0) return c;
+  }
+  return NULL;
+}
+
+int PathCandidates::score(const PathCandidate& c, uint32_t now) {
+  int s = 100 - 10 * c.path_len;    // fewer hops is better
+  if (c.snr != PATH_SNR_UNKNOWN) {
+    int snr = c.snr / 4;
+    s += 2 * (snr < -10 ? -10 : (snr > 10 ? 10 : snr));
+  }
+  if (c.sent > 0) {
+    s += (c.acked * 40) / c.sent - 20;
+  }
+  s -= 30 * c.fails;
+  uint32_t age_hours = (now - c.heard) / 3600;
+  s -= age_hours > 20 ? 20 : age_hours;   // older paths are more likely to be stale
+  return s;
+}
+
+const PathCandidate* PathCandidates::best(const Entry* e, uint32_t now) {
+  const PathCandidate* b = NULL;
+  int b_score = 0;
+  for (int i = 0; i < PATH_CANDIDATES_PER_CONTACT; i++) {
+    auto c = &e->cands[i];
+    if (!c->isUsable()) continue;
+    int s = score(*c, now);
+    if (b == NULL || s > b_score) {
+      b = c;
+      b_score = s;
+    }
+  }
+  return b;
+}
+
+const PathCandidate* PathCandidates::onPathRecv(const uint8_t* pub_key, const uint8_t* path, uint8_t path_len, int8_t snr, uint32_t now) {
+  if (path_len > MAX_PATH_SIZE) return NULL;
+
+  Entry* e = find(pub_key);
+  if (e == NULL) {   // use unused entry, else evict least recently used
+    e = &_entries[0];
+    for (int i = 0; i < MAX_PATH_CANDIDATE_CONTACTS; i++) {
+      if (_entries[i].last_used < e->last_used) e = &_entries[i];
+      if (e->last_used == 0) break;
+    }
+    memset(e, 0, sizeof(*e));
+    memcpy(e->pub_key, pub_key, sizeof(e->pub_key));
+    e->last_used = ++_use_counter;
+  }
+
+  PathCandidate* c = findPath(e, path, path_len);
+  if (c == NULL) {   // use unused slot, else replace lowest scoring
+    c = &e->cands[0];
+    for (int i = 0; i < PATH_CANDIDATES_PER_CONTACT; i++) {
+      auto p = &e->cands[i];
+      if (p->heard == 0) { c = p; break; }
+      if (!p->isUsable() || score(*p, now) < score(*c, now)) c = p;
+    }
+    memset(c, 0, sizeof(*c));
+    c->path_len = path_len;
+    memcpy(c->path, path, path_len);
+    c->snr = PATH_SNR_UNKNOWN;
+  }
+  c->heard = now ? now : 1;
+  c->fails = 0;   // has just worked (in reverse direction, at least)
+  if (snr != PATH_SNR_UNKNOWN) c->snr = snr;
+
+  return c;   // newest path has just been proven to work, so use it (as route may have changed)
+}
+
+bool PathCandidates::onSent(const uint8_t* pub_key, const uint8_t* path, uint8_t path_len) {
+  Entry* e = find(pub_key);
+  PathCandidate* c = e ? findPath(e, path, path_len) : NULL;
+  if (c == NULL) return false;   // eg. path was set manually
+
+  if (c->sent == 0xFF) {   // keep ratio, when saturated
+    c->sent >>= 1;
+    c->acked >>= 1;
+  }
+  c->sent++;
+  return true;
+}
+
+void PathCandidates::onDelivered(const uint8_t* pub_key, const uint8_t* path, uint8_t path_len) {
+  Entry* e = find(pub_key);
+  PathCandidate* c = e ? findPath(e, path, path_len) : NULL;
+  if (c) {
+    if (c->acked < c->sent) c->acked++;
+    c->fails = 0;
+  }
+}
+
+const PathCandidate* PathCandidates::onFailed(const uint8_t* pub_key, const uint8_t* path, uint8_t path_len, uint32_t now) {
+  Entry* e = find(pub_key);
+  if (e == NULL) return NULL;
+
+  PathCandidate* c = findPath(e, path, path_len);
+  if (c && c->fails < 0xFF) c->fails++;
+  return best(e, now);
+}
+
+void PathCandidates::onTrace(const uint8_t* path_hashes, const int8_t* path_snrs, uint8_t len) {
+  for (int i = 0; i < MAX_PATH_CANDIDATE_CONTACTS; i++) {
+    if (_entries[i].last_used == 0) continue;
+    for (int j = 0; j < PATH_CANDIDATES_PER_CONTACT; j++) {
+      auto c = &_entries[i].cands[j];
+      if (c->heard == 0 || c->path_len == 0 || c->path_len > len || memcmp(c->path, path_hashes, c->path_len) != 0) continue;
+
+      int8_t weakest = path_snrs[0];
+      for (int k = 1; k < c->path_len; k++) {
+        if (path_snrs[k] < weakest) weakest = path_snrs[k];
+      }
+      c->snr = weakest;
+    }
+  }
+}
+
+void PathCandidates::remove(const uint8_t* pub_key) {
+  Entry* e = find(pub_key);
+  if (e) memset(e, 0, sizeof(*e));
+}
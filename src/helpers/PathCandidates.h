@@ -0,0 +1,77 @@
+#pragma once
+
+#include <Arduino.h>   // needed for PlatformIO
+#include <Mesh.h>
+
+#ifndef MAX_PATH_CANDIDATE_CONTACTS
+  #define MAX_PATH_CANDIDATE_CONTACTS   8    // most recently used contacts, that have candidates kept
+#endif
+#ifndef PATH_CANDIDATES_PER_CONTACT
+  #define PATH_CANDIDATES_PER_CONTACT   3
+#endif
+#define PATH_CANDIDATE_MAX_FAILS        2    // consecutive failures, before a candidate is no longer used
+
+#define PATH_SNR_UNKNOWN   -128
+
+struct PathCandidate {
+  uint32_t heard;       // by OUR clock, when last received as a return path, 0 = unused
+  uint8_t path_len;
+  int8_t snr;           // weakest known hop, multiplied by 4, or PATH_SNR_UNKNOWN
+  uint8_t sent, acked;  // direct sends (with ACK expected), and how many were ACKed
+  uint8_t fails;        // consecutive
+  uint8_t path[MAX_PATH_SIZE];
+
+  bool isUsable() const { return heard != 0 && fails < PATH_CANDIDATE_MAX_FAILS; }
+};
+
+/**
+ * \brief  a few candidate out_paths per contact (in RAM only), scored by hop count, known hop SNR and observed
+ *         delivery. The contact's out_path is set to the path most recently returned, and on failures, fails
+ *         over to the next best scoring, before falling back to flood.
+ */
+class PathCandidates {
+  struct Entry {
+    uint8_t pub_key[6];    // prefix
+    uint32_t last_used;    // 0 = unused entry
+    PathCandidate cands[PATH_CANDIDATES_PER_CONTACT];
+  };
+
+  Entry _entries[MAX_PATH_CANDIDATE_CONTACTS];
+  uint32_t _use_counter;
+
+  Entry* find(const uint8_t* pub_key);
+  static PathCandidate* findPath(Entry* e, const uint8_t* path, uint8_t path_len);
+  static const PathCandidate* best(const Entry* e, uint32_t now);
+
+public:
+  PathCandidates() : _use_counter(0) { memset(_entries, 0, sizeof(_entries)); }
+
+  static int score(const PathCandidate& c, uint32_t now);
+
+  /**
+   * \brief  a return path was received from contact
+   * \param  snr  of first hop (x4), or PATH_SNR_UNKNOWN
+   * \returns  this path's candidate, which should be used now. NOTE: not the best scoring one, as after a route
+   *           change older (eg. shorter) candidates may be dead, but not yet failed. The others are for fail-over.
+   */
+  const PathCandidate* onPathRecv(const uint8_t* pub_key, const uint8_t* path, uint8_t path_len, int8_t snr, uint32_t now);
+
+  /**
+   * \returns  true if path is one of contact's candidates
+   */
+  bool onSent(const uint8_t* pub_key, const uint8_t* path, uint8_t path_len);
+  void onDelivered(const uint8_t* pub_key, const uint8_t* path, uint8_t path_len);
+
+  /**
+   * \brief  no ACK, for a send via given path
+   * \returns  next best candidate, or NULL if none usable (ie. fallback to flood)
+   */
+  const PathCandidate* onFailed(const uint8_t* pub_key, const uint8_t* path, uint8_t path_len, uint32_t now);
+
+  /**
+   * \brief  per-hop SNRs from a TRACE (1-byte hashes only). Updates candidates (of any contact) which the traced path starts with.
+   */
+  void onTrace(const uint8_t* path_hashes, const int8_t* path_snrs, uint8_t len);
+
+  void remove(const uint8_t* pub_key);
+};
@@ -0,0 +1,82 @@
+#include "PcapCapture.h"
+#include <helpers/RecordHelpers.h>
+
+#define BLOCK_TYPE_SHB   0x0A0D0D0A
+#define BLOCK_TYPE_IDB   0x00000001
+#define BLOCK_TYPE_EPB   0x00000006
+
+#define OPT_ENDOFOPT      0
+#define OPT_IF_TSRESOL    9
+
+bool PcapCapture::writeBlock(uint32_t type, const uint8_t* body, uint32_t body_len, const uint8_t* data, uint32_t data_len) {
+  static const uint8_t zeroes[4] = {0, 0, 0, 0};
+  uint32_t pad = (4 - (data_len & 3)) & 3;
+  uint8_t tmp[8];
+  writeLE32(&tmp[0], type);
+  writeLE32(&tmp[4], 12 + body_len + data_len + pad);   // total block length
+
+  bool success = _out->write(tmp, 8) == 8 && _out->write(body, body_len) == body_len;
+  if (success && data_len > 0) {
+    success = _out->write(data, data_len) == data_len && (pad == 0 || _out->write(zeroes, pad) == pad);
+  }
+  return success && _out->write(&tmp[4], 4) == 4;   // trailing copy of length
+}
+
+bool PcapCapture::begin(Print& out, uint32_t rtc_now, unsigned long now_millis) {
+  _out = &out;
+  _base_time = rtc_now;
+  _base_millis = now_millis;
+  _num_frames = 0;
+
+  uint8_t shb[16];
+  writeLE32(&shb[0], 0x1A2B3C4D);   // byte-order magic
+  writeLE16(&shb[4], 1);   // major version
+  writeLE16(&shb[6], 0);   // minor
+  memset(&shb[8], 0xFF, 8);   // section length: unspecified
+
+  uint8_t idb[20];
+  writeLE16(&idb[0], PCAP_LINKTYPE_LORA);
+  writeLE16(&idb[2], 0);
+  writeLE32(&idb[4], 0);   // snaplen: no limit
+  writeLE16(&idb[8], OPT_IF_TSRESOL);
+  writeLE16(&idb[10], 1);
+  idb[12] = 3;   // 10^-3 secs
+  idb[13] = idb[14] = idb[15] = 0;   // padding
+  writeLE16(&idb[16], OPT_ENDOFOPT);
+  writeLE16(&idb[18], 0);
+
+  if (writeBlock(BLOCK_TYPE_SHB, shb, sizeof(shb), NULL, 0) && writeBlock(BLOCK_TYPE_IDB, idb, sizeof(idb), NULL, 0)) {
+    return true;
+  }
+  _out = NULL;
+  return false;
+}
+
+bool PcapCapture::writeFrame(const LoRaFrameMeta& meta, unsigned long now_millis, const uint8_t raw[], int len) {
+  if (_out == NULL || len <= 0) return false;
+
+  uint64_t ts = (uint64_t)_base_time * 1000 + (uint32_t)(now_millis - _base_millis);
+
+  uint8_t body[20 + PCAP_LORA_HDR_LEN];
+  writeLE32(&body[0], 0);   // interface id
+  writeLE32(&body[4], (uint32_t)(ts >> 32));
+  writeLE32(&body[8], (uint32_t)ts);
+  writeLE32(&body[12], PCAP_LORA_HDR_LEN + len);   // captured len
+  writeLE32(&body[16], PCAP_LORA_HDR_LEN + len);   // original len
+
+  uint8_t* hdr = &body[20];
+  hdr[0] = PCAP_LORA_HDR_VERSION;
+  hdr[1] = PCAP_LORA_HDR_LEN;
+  hdr[2] = meta.is_tx ? PCAP_LORA_FLAG_TX : 0;
+  hdr[3] = meta.sf;
+  hdr[4] = meta.cr;
+  hdr[5] = (int8_t)(meta.snr * 4);
+  writeLE16(&hdr[6], (int16_t)meta.rssi);
+  writeLE32(&hdr[8], (uint32_t)(meta.freq * 1000.0f + 0.5f));
+  writeLE32(&hdr[12], (uint32_t)(meta.bw * 1000.0f + 0.5f));
+  writeLE32(&hdr[16], meta.airtime);
+
+  if (!writeBlock(BLOCK_TYPE_EPB, body, sizeof(body), raw, len)) return false;
+  _num_frames++;
+  return true;
+}
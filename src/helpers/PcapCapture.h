@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Arduino.h>   // needed for PlatformIO
+
+/*
+  Writes raw LoRa frames as a pcapng stream (Section Header, one Interface Description, then an Enhanced
+  Packet Block per frame), to any Print: an open File, or a spare serial port.
+
+  Link-type is LINKTYPE_USER0 (147). Each frame's data is prefixed with a pseudo-header (little-endian):
+    [0]      version (1)
+    [1]      pseudo-header length (20)
+    [2]      flags (PCAP_LORA_FLAG_*)
+    [3]      spreading factor
+    [4]      coding rate
+    [5]      SNR * 4 (int8)
+    [6..7]   RSSI, dBm (int16)
+    [8..11]  frequency, kHz
+    [12..15] bandwidth, Hz
+    [16..19] estimated airtime, millis
+  followed by the raw frame bytes.
+*/
+
+#define PCAP_LINKTYPE_LORA      147
+#define PCAP_LORA_HDR_VERSION     1
+#define PCAP_LORA_HDR_LEN        20
+
+#define PCAP_LORA_FLAG_TX      0x01
+
+struct LoRaFrameMeta {
+  float snr, rssi;
+  float freq;   // MHz
+  float bw;     // kHz
+  uint8_t sf, cr;
+  uint32_t airtime;   // millis
+  bool is_tx;
+};
+
+class PcapCapture {
+  Print* _out;
+  uint32_t _base_time;              // RTC at begin()
+  unsigned long _base_millis;       // millis() at begin()
+  uint32_t _num_frames;
+
+  bool writeBlock(uint32_t type, const uint8_t* body, uint32_t body_len, const uint8_t* data, uint32_t data_len);
+
+public:
+  PcapCapture() : _out(NULL), _base_time(0), _base_millis(0), _num_frames(0) { }
+
+  /**
+   * \brief  starts a new pcapng section on 'out'. Frame timestamps are reconstructed from the RTC time and
+   *         millis() given here (timestamp resolution is millis).
+   */
+  bool begin(Print& out, uint32_t rtc_now, unsigned long now_millis);
+  void end() { _out = NULL; }
+  bool isActive() const { return _out != NULL; }
+
+  bool writeFrame(const LoRaFrameMeta& meta, unsigned long now_millis, const uint8_t raw[], int len);
+
+  uint32_t getNumFrames() const { return _num_frames; }
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <helpers/IdentityStore.h>   // for File, FILESYSTEM
+
+// on-disk records are little-endian, regardless of host
+inline uint16_t readLE16(const uint8_t* p) { return p[0] | ((uint16_t)p[1] << 8); }
+inline uint32_t readLE32(const uint8_t* p) {
+  return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+inline void writeLE16(uint8_t* p, uint16_t v) { p[0] = v; p[1] = v >> 8; }
+inline void writeLE32(uint8_t* p, uint32_t v) { p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24; }
+
+/**
+ * \brief  reads fixed size records from a File, a block (of several records) per file read
+ */
+class BlockRecordReader {
+  File* _file;
+  uint8_t* _buf;
+  int _rec_size, _max_recs;
+  int _num, _idx;
+  uint32_t _block_pos;
+
+public:
+  BlockRecordReader(File& file, uint8_t* buf, int buf_size, int rec_size)
+    : _file(&file), _buf(buf), _rec_size(rec_size), _max_recs(buf_size / rec_size), _num(0), _idx(0), _block_pos(0) { }
+
+  /**
+   * \returns  pointer to next record (in buf), or NULL at EOF. A trailing partial record is treated as EOF.
+   */
+  const uint8_t* next() {
+    if (_idx >= _num) {
+      _block_pos += _num * _rec_size;
+      _num = _file->read(_buf, _max_recs * _rec_size) / _rec_size;
+      _idx = 0;
+      if (_num <= 0) return NULL;
+    }
+    return &_buf[_rec_size * _idx++];
+  }
+
+  // file offset of record last returned by next()
+  uint32_t lastPos() const { return _block_pos + (_idx - 1) * _rec_size; }
+};
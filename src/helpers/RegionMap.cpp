@@ -273,7 +273,7 @@ void RegionMap::printChildRegions(int indent, const RegionEntry* parent, Stream&
   if (parent->flags & REGION_DENY_FLOOD) {
     out.printf("%s%s\n", skip_hash(parent->name), parent->id == home_id ? "^" : "");
   } else {
-    out.printf("%s%s F\n", skip_hash(parent->name), parent->id == home_id ? "^" : "");
+    out.printf("%s%s F%s\n", skip_hash(parent->name), parent->id == home_id ? "^" : "", (parent->flags & REGION_GOSSIP) ? "G" : "");
   }
 
   for (int i = 0; i < num_regions; i++) {
@@ -0,0 +1,49 @@
+#include "SourceRateLimiter.h"
+#include <string.h>
+
+#define TOKEN_UNIT   60000    // millis per minute
+
+void SourceRateLimiter::clear() {
+  memset(_buckets, 0, sizeof(_buckets));
+}
+
+int SourceRateLimiter::check(uint32_t src, unsigned long now_millis, uint8_t rate, uint8_t burst) {
+  if (rate == 0 || src == 0) return RATE_ALLOW;
+  if (burst == 0) burst = 1;
+
+  int32_t full = (int32_t)burst * TOKEN_UNIT;
+  Bucket* b = NULL;
+  Bucket* lru = &_buckets[0];
+  for (int i = 0; i < MAX_RATE_SOURCES; i++) {
+    if (_buckets[i].src == src) {
+      b = &_buckets[i];
+      break;
+    }
+    if (lru->src && (_buckets[i].src == 0 || _buckets[i].last_millis < lru->last_millis)) lru = &_buckets[i];
+  }
+  if (b == NULL) {   // new source, starts with full bucket
+    if (lru->src) _n_evicted++;
+    b = lru;
+    b->src = src;
+    b->tokens = full;
+  } else {   // refill
+    unsigned long elapsed = now_millis - b->last_millis;
+    if (elapsed >= (unsigned long)(2 * full) / rate) {   // enough to refill from max debt (and avoids overflow)
+      b->tokens = full;
+    } else {
+      b->tokens += (int32_t)(elapsed * rate);
+      if (b->tokens > full) b->tokens = full;
+    }
+  }
+  b->last_millis = now_millis;
+
+  if (b->tokens >= TOKEN_UNIT - full) {   // bucket can go into 'debt' of up to 'burst'
+    b->tokens -= TOKEN_UNIT;
+    if (b->tokens >= 0) return RATE_ALLOW;
+
+    _n_deferred++;
+    return RATE_DEFER;
+  }
+  _n_denied++;   // NOTE: not charged, so source recovers at the normal rate
+  return RATE_DENY;
+}
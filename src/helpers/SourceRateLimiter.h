@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifndef MAX_RATE_SOURCES
+  #define MAX_RATE_SOURCES   32
+#endif
+
+#define RATE_ALLOW    0
+#define RATE_DEFER    1    // over budget, but within burst allowance again: forward at lower priority
+#define RATE_DENY     2
+
+/**
+ * \brief  per-source token buckets, for flood forwarding. Each source may send 'rate' packets per minute,
+ *         with bursts of up to 'burst'. Once a bucket is empty, a further 'burst' packets are deferred,
+ *         then the rest denied until it refills. Least recently active sources are evicted when full.
+ */
+class SourceRateLimiter {
+  struct Bucket {
+    uint32_t src;     // 0 = unused entry
+    int32_t tokens;   // in 1/60000ths of a packet, ie. refills 'rate' per millisecond
+    unsigned long last_millis;
+  };
+
+  Bucket _buckets[MAX_RATE_SOURCES];
+  uint32_t _n_deferred, _n_denied, _n_evicted;
+
+public:
+  SourceRateLimiter() { clear(); resetStats(); }
+
+  void clear();
+
+  /**
+   * \param  src  source key, non-zero
+   * \param  rate  packets per minute, 0 = no limit
+   * \returns  one of RATE_ALLOW, RATE_DEFER, RATE_DENY
+   */
+  int check(uint32_t src, unsigned long now_millis, uint8_t rate, uint8_t burst);
+
+  uint32_t getNumDeferred() const { return _n_deferred; }
+  uint32_t getNumDenied() const { return _n_denied; }
+  uint32_t getNumEvicted() const { return _n_evicted; }
+  void resetStats() { _n_deferred = _n_denied = _n_evicted = 0; }
+};
@@ -0,0 +1,93 @@
+#include "StatsHistory.h"
+#include <string.h>
+#include <helpers/RecordHelpers.h>
+
+static uint16_t delta16(uint32_t curr, uint32_t last) {
+  uint32_t d = curr >= last ? curr - last : curr;   // counters may have been reset
+  return d > 0xFFFF ? 0xFFFF : d;
+}
+
+static uint8_t sat8(uint32_t v) {
+  return v > 0xFF ? 0xFF : v;
+}
+
+const StatsHistory::Bucket& StatsHistory::getAgo(int ago) const {
+  return _ring[(_next - 1 - ago + STATS_HISTORY_MINUTES) % STATS_HISTORY_MINUTES];
+}
+
+void StatsHistory::begin(const StatsTotals& totals) {
+  _last = totals;
+}
+
+void StatsHistory::sampleQueue(int queue_len, int free_count) {
+  if (queue_len > _queue_max) _queue_max = sat8(queue_len);
+  if (free_count < _pool_free_min) _pool_free_min = free_count < 0 ? 0 : free_count;
+}
+
+void StatsHistory::endMinute(const StatsTotals& totals, int noise_floor, uint32_t now) {
+  Bucket& b = _ring[_next];
+  b.tx_air_ms = delta16(totals.tx_air_ms, _last.tx_air_ms);
+  b.rx_air_ms = delta16(totals.rx_air_ms, _last.rx_air_ms);
+  b.flood_in = delta16(totals.n_recv_flood, _last.n_recv_flood);
+  b.flood_out = delta16(totals.n_sent_flood, _last.n_sent_flood);
+  b.direct_in = delta16(totals.n_recv_direct, _last.n_recv_direct);
+  b.direct_out = delta16(totals.n_sent_direct, _last.n_sent_direct);
+  b.dups = delta16(totals.n_dups, _last.n_dups);
+  b.queue_max = _queue_max;
+  b.pool_free_min = _pool_free_min;
+  b.noise_floor = noise_floor < -128 ? -128 : (noise_floor > 0 ? 0 : noise_floor);
+
+  _next = (_next + 1) % STATS_HISTORY_MINUTES;
+  if (_count < STATS_HISTORY_MINUTES) _count++;
+  _last = totals;
+  _last_timestamp = now;
+  _queue_max = 0;
+  _pool_free_min = 0xFF;
+}
+
+int StatsHistory::exportRange(uint16_t end_ago, uint8_t step, uint8_t max_recs, uint8_t* dest, int max_len) const {
+  if (step == 0) step = 1;
+  int avail = _count > end_ago ? _count - end_ago : 0;
+  int n = (avail + step - 1) / step;   // oldest record may cover fewer minutes
+  if (n > max_recs) n = max_recs;
+  if (n > (max_len - STATS_HISTORY_HEADER_SIZE) / STATS_HISTORY_REC_SIZE) n = (max_len - STATS_HISTORY_HEADER_SIZE) / STATS_HISTORY_REC_SIZE;
+  if (n < 0) n = 0;
+
+  int i = 0;
+  writeLE32(&dest[i], _last_timestamp); i += 4;
+  writeLE16(&dest[i], _count); i += 2;
+  writeLE16(&dest[i], end_ago); i += 2;
+  dest[i++] = step;
+  dest[i++] = n;
+
+  for (int r = n - 1; r >= 0; r--) {   // oldest first
+    uint32_t tx = 0, rx = 0, f_in = 0, f_out = 0, d_in = 0, d_out = 0, dups = 0;
+    int noise = 0;
+    uint8_t q_max = 0, free_min = 0xFF;
+    int mins = 0;
+    for (int m = 0; m < step; m++) {
+      int ago = end_ago + r * step + m;
+      if (ago >= _count) break;
+      const Bucket& b = getAgo(ago);
+      tx += b.tx_air_ms; rx += b.rx_air_ms;
+      f_in += b.flood_in; f_out += b.flood_out;
+      d_in += b.direct_in; d_out += b.direct_out;
+      dups += b.dups;
+      noise += b.noise_floor;
+      if (b.queue_max > q_max) q_max = b.queue_max;
+      if (b.pool_free_min < free_min) free_min = b.pool_free_min;
+      mins++;
+    }
+    dest[i++] = sat8(tx / (mins * 300));   // percent * 2, of 60000 ms
+    dest[i++] = sat8(rx / (mins * 300));
+    dest[i++] = sat8((f_in + mins / 2) / mins);
+    dest[i++] = sat8((f_out + mins / 2) / mins);
+    dest[i++] = sat8((d_in + mins / 2) / mins);
+    dest[i++] = sat8((d_out + mins / 2) / mins);
+    dest[i++] = sat8((dups + mins / 2) / mins);
+    dest[i++] = q_max;
+    dest[i++] = free_min;
+    dest[i++] = (uint8_t)(int8_t)(noise / mins);
+  }
+  return i;
+}
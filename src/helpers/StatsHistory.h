@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifndef STATS_HISTORY_MINUTES
+  #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+    #define STATS_HISTORY_MINUTES    60
+  #else
+    #define STATS_HISTORY_MINUTES   240
+  #endif
+#endif
+
+#define STATS_HISTORY_HEADER_SIZE   10
+#define STATS_HISTORY_REC_SIZE      10
+
+/**
+ * \brief  cumulative counters, as sampled at end of each minute
+ */
+struct StatsTotals {
+  uint32_t tx_air_ms, rx_air_ms;
+  uint32_t n_recv_flood, n_sent_flood;
+  uint32_t n_recv_direct, n_sent_direct;
+  uint32_t n_dups;
+};
+
+/**
+ * \brief  ring of per-minute stats buckets, so load over time can be fetched in one request, instead of
+ *         polling the cumulative counters.
+ */
+class StatsHistory {
+  struct Bucket {
+    uint16_t tx_air_ms, rx_air_ms;
+    uint16_t flood_in, flood_out;
+    uint16_t direct_in, direct_out;
+    uint16_t dups;
+    uint8_t queue_max;      // high-water of outbound queue
+    uint8_t pool_free_min;  // low-water of free packets
+    int8_t noise_floor;
+  };
+
+  Bucket _ring[STATS_HISTORY_MINUTES];
+  int _next, _count;
+  StatsTotals _last;
+  uint32_t _last_timestamp;   // RTC time, when newest bucket completed
+  uint8_t _queue_max, _pool_free_min;
+
+  const Bucket& getAgo(int ago) const;   // 0 = newest
+
+public:
+  StatsHistory() : _next(0), _count(0), _last_timestamp(0), _queue_max(0), _pool_free_min(0xFF) { }
+
+  /**
+   * \brief  start of history, or after counters have been reset
+   */
+  void begin(const StatsTotals& totals);
+
+  /**
+   * \brief  called often, to track queue high-water and free packets low-water for current minute
+   */
+  void sampleQueue(int queue_len, int free_count);
+
+  void endMinute(const StatsTotals& totals, int noise_floor, uint32_t now);
+
+  int getNumMinutes() const { return _count; }
+
+  /**
+   * \brief  binary export, records downsampled to 'step' minutes each, oldest first. Header: timestamp of newest
+   *         bucket(4), minutes available(2), end_ago(2), step(1), num records(1). Record: TX airtime %*2 (1),
+   *         RX airtime %*2 (1), per minute averages of: flood in(1), flood out(1), direct in(1), direct out(1),
+   *         dups(1), then queue high-water(1), free packets low-water(1), avg noise floor(1, signed).
+   * \param  end_ago  minutes before newest bucket, of the newest record
+   * \returns  number of bytes written to 'dest'
+   */
+  int exportRange(uint16_t end_ago, uint8_t step, uint8_t max_recs, uint8_t* dest, int max_len) const;
+};
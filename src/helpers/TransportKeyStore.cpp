@@ -24,23 +24,70 @@ bool TransportKey::isNull() const {
   return true;  // key is all zeroes
 }
 
+void TransportKeyStore::invalidateCache() {
+  memset(cache, 0, sizeof(cache));
+  memset(buckets, 0, sizeof(buckets));
+  use_counter = 0;
+}
+
+int TransportKeyStore::findCache(uint16_t id, TransportKey keys[], int max_num) {
+  int n = 0;
+  uint8_t i = buckets[id & (TKS_HASH_BUCKETS - 1)];
+  while (i && n < max_num) {
+    auto e = &cache[i - 1];
+    if (e->id == id) {
+      e->last_used = ++use_counter;
+      keys[n++] = e->key;
+    }
+    i = e->next;
+  }
+  return n;
+}
+
+void TransportKeyStore::removeCache(uint16_t id) {
+  uint8_t* link = &buckets[id & (TKS_HASH_BUCKETS - 1)];
+  while (*link) {
+    auto e = &cache[*link - 1];
+    if (e->id == id) {
+      *link = e->next;   // unlink
+      memset(e, 0, sizeof(*e));
+    } else {
+      link = &e->next;
+    }
+  }
+}
+
 void TransportKeyStore::putCache(uint16_t id, const TransportKey& key) {
-  if (num_cache < MAX_TKS_ENTRIES) {
-    cache_ids[num_cache] = id;
-    cache_keys[num_cache] = key;
-    num_cache++;
-  } else {
-    // TODO: evict oldest cache entry
+  // use a free entry, else evict least recently used
+  int idx = 0;
+  for (int i = 0; i < MAX_TKS_ENTRIES; i++) {
+    if (cache[i].last_used == 0) {
+      idx = i;
+      break;
+    }
+    if (cache[i].last_used < cache[idx].last_used) idx = i;
   }
+  if (cache[idx].last_used) {
+    removeCache(cache[idx].id);   // evict ALL keys for that id, so a lookup never gets a partial set
+    n_evictions++;
+  }
+
+  auto e = &cache[idx];
+  e->key = key;
+  e->id = id;
+  e->last_used = ++use_counter;
+  uint8_t* head = &buckets[id & (TKS_HASH_BUCKETS - 1)];
+  e->next = *head;
+  *head = idx + 1;
 }
 
 void TransportKeyStore::getAutoKeyFor(uint16_t id, const char* name, TransportKey& dest) {
-  for (int i = 0; i < num_cache; i++) {  // first, check cache
-    if (cache_ids[i] == id) {   // cache hit!
-      dest = cache_keys[i];
-      return;
-    }
+  if (findCache(id, &dest, 1) > 0) {   // cache hit!
+    n_hits++;
+    return;
   }
+  n_misses++;
+
   // calc key for publicly-known hashtag region name
   SHA256 sha;
   sha.update(name, strlen(name));
@@ -50,17 +97,16 @@ void TransportKeyStore::getAutoKeyFor(uint16_t id, const char* name, TransportKe
 }
 
 int TransportKeyStore::loadKeysFor(uint16_t id, TransportKey keys[], int max_num) {
-  int n = 0;
-  for (int i = 0; i < num_cache && n < max_num; i++) {  // first, check cache
-    if (cache_ids[i] == id) {
-      keys[n++] = cache_keys[i];
-    }
+  int n = findCache(id, keys, max_num);
+  if (n > 0) {   // cache hit!
+    n_hits++;
+    return n;
   }
-  if (n > 0) return n;   // cache hit!
+  n_misses++;
 
   // TODO:  retrieve from difficult-to-copy keystore
 
-  // store in cache (if room)
+  // store in cache
   for (int i = 0; i < n; i++) {
     putCache(id, keys[i]);
   }
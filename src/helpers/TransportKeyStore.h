@@ -11,21 +11,47 @@ struct TransportKey {
   bool isNull() const;
 };
 
-#define MAX_TKS_ENTRIES   16
+#ifndef MAX_TKS_ENTRIES
+  #define MAX_TKS_ENTRIES   32    // cached keys, ideally >= MAX_REGION_ENTRIES
+#endif
+#define TKS_HASH_BUCKETS    16    // must be power of 2
 
+#if MAX_TKS_ENTRIES > 255
+  #error "MAX_TKS_ENTRIES must fit uint8_t index"
+#endif
+
+/**
+ * \brief  transport keys by region id. Keys (auto hashtag, or loaded from keystore) are held in a small
+ *         LRU cache, hashed by region id, so per-packet lookups don't need to re-calc or re-load them.
+ */
 class TransportKeyStore {
-  uint16_t     cache_ids[MAX_TKS_ENTRIES];
-  TransportKey cache_keys[MAX_TKS_ENTRIES];
-  int num_cache;
+  struct CacheEntry {
+    TransportKey key;
+    uint32_t last_used;   // 0 = unused entry
+    uint16_t id;
+    uint8_t next;    // (index + 1) of next in same hash bucket, 0 = end
+  };
+
+  CacheEntry cache[MAX_TKS_ENTRIES];
+  uint8_t buckets[TKS_HASH_BUCKETS];    // (index + 1) of first in bucket
+  uint32_t use_counter;
+  uint32_t n_hits, n_misses, n_evictions;
 
   void putCache(uint16_t id, const TransportKey& key);
-  void invalidateCache() { num_cache = 0; }
+  void removeCache(uint16_t id);
+  int findCache(uint16_t id, TransportKey keys[], int max_num);
 
 public:
-  TransportKeyStore() { num_cache = 0; }
+  TransportKeyStore() { invalidateCache(); resetStats(); }
   void getAutoKeyFor(uint16_t id, const char* name, TransportKey& dest);
   int loadKeysFor(uint16_t id, TransportKey keys[], int max_num);
   bool saveKeysFor(uint16_t id, const TransportKey keys[], int num);
   bool removeKeys(uint16_t id);
   bool clear();
+  void invalidateCache();
+
+  uint32_t getNumCacheHits() const { return n_hits; }
+  uint32_t getNumCacheMisses() const { return n_misses; }
+  uint32_t getNumCacheEvictions() const { return n_evictions; }
+  void resetStats() { n_hits = n_misses = n_evictions = 0; }
 };
@@ -26,6 +26,61 @@ bool StrHelper::isBlank(const char* str) {
   return true;
 }
 
+static uint32_t foldCodePoint(uint32_t c) {
+  if (c < 0x80) return (c >= 'A' && c <= 'Z') ? c + 32 : c;
+  if (c >= 0xC0 && c <= 0xDE && c != 0xD7) return c + 0x20;   // Latin-1
+  if (c >= 0x100 && c <= 0x17F) {   // Latin Extended-A, mostly upper/lower pairs
+    if (c == 0x178) return 0xFF;
+    if ((c >= 0x139 && c <= 0x148) || (c >= 0x179 && c <= 0x17E)) return (c & 1) ? c + 1 : c;
+    if (c != 0x130 && c != 0x131 && c != 0x138 && c != 0x149 && c != 0x17F) return c | 1;
+    return c;
+  }
+  if (c >= 0x391 && c <= 0x3A9 && c != 0x3A2) return c + 0x20;   // Greek
+  if (c >= 0x410 && c <= 0x42F) return c + 0x20;   // Cyrillic
+  if (c >= 0x400 && c <= 0x40F) return c + 0x50;
+  return c;
+}
+
+uint32_t StrHelper::nextFoldedChar(const char*& sp) {
+  const uint8_t* s = (const uint8_t *) sp;
+  uint32_t c = *s;
+  if (c == 0) return 0;   // NOTE: does not advance past end
+
+  int n = 0;
+  if (c >= 0xF0 && c <= 0xF7) { n = 3; c &= 0x07; }
+  else if (c >= 0xE0) { n = 2; c &= 0x0F; }
+  else if (c >= 0xC0) { n = 1; c &= 0x1F; }
+
+  int i = 1;
+  while (i <= n && (s[i] & 0xC0) == 0x80) {
+    c = (c << 6) | (s[i] & 0x3F);
+    i++;
+  }
+  if (i <= n) {   // invalid/truncated sequence, just treat lead byte as a char
+    sp++;
+    return s[0];
+  }
+  sp += i;
+  return foldCodePoint(c);
+}
+
+int StrHelper::compareFolded(const char* a, const char* b) {
+  while (true) {
+    uint32_t ca = nextFoldedChar(a);
+    uint32_t cb = nextFoldedChar(b);
+    if (ca != cb) return ca < cb ? -1 : 1;
+    if (ca == 0) return 0;
+  }
+}
+
+bool StrHelper::startsWithFolded(const char* str, const char* prefix) {
+  while (true) {
+    uint32_t cp = nextFoldedChar(prefix);
+    if (cp == 0) return true;
+    if (nextFoldedChar(str) != cp) return false;
+  }
+}
+
 #include <Arduino.h>
 
 union int32_Float_t 
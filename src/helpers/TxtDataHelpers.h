@@ -6,6 +6,11 @@
 #define TXT_TYPE_PLAIN          0    // a plain text message
 #define TXT_TYPE_CLI_DATA       1    // a CLI command
 #define TXT_TYPE_SIGNED_PLAIN   2    // plain text, signed by sender
+#define TXT_TYPE_SIGNED_BUNDLE  3    // several signed plain texts (room server push)
+#define TXT_TYPE_ROOM_KEY       4    // room server's group key, for live posts sent as GRP_DATA
+
+#define LOGIN_CAP_SIGNED_BUNDLE   0x01   // room login: client accepts TXT_TYPE_SIGNED_BUNDLE
+#define LOGIN_CAP_ROOM_KEY        0x02   // room login: client accepts TXT_TYPE_ROOM_KEY
 
 class StrHelper {
 public:
@@ -14,5 +19,8 @@ public:
   static const char* ftoa(float f);
   static const char* ftoa3(float f); //Converts float to string with 3 decimal places
   static bool isBlank(const char* str);
+  static uint32_t nextFoldedChar(const char*& sp);   // decodes next UTF-8 char, lower-cased. Returns 0 at end of string
+  static int  compareFolded(const char* a, const char* b);   // case-insensitive, UTF-8 aware, strcmp() style result
+  static bool startsWithFolded(const char* str, const char* prefix);
   static uint32_t fromHex(const char* src);
 };
@@ -0,0 +1,308 @@
+#include "PosixFileSystem.h"
+#include <dirent.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace posixfs {
+
+struct File::Handle {
+  PosixFS* fs;
+  std::string path;    // as given to open(), ie. relative to root
+  FILE* fp;
+  DIR* dir;
+  bool append;         // all writes go to end of file
+  std::set<uint32_t> dirty_blocks;
+
+  Handle(PosixFS* _fs, const std::string& _path) : fs(_fs), path(_path), fp(NULL), dir(NULL), append(false) { }
+  ~Handle() {
+    if (fp) fclose(fp);
+    if (dir) closedir(dir);
+  }
+};
+
+static bool isDir(const std::string& full_path) {
+  struct stat st;
+  return stat(full_path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static void makeParentDirs(const std::string& full_path) {
+  for (size_t i = 1; i < full_path.size(); i++) {
+    if (full_path[i] == '/') ::mkdir(full_path.substr(0, i).c_str(), 0755);
+  }
+}
+
+/* ------------------------------------ File -------------------------------------- */
+
+size_t File::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t File::write(const uint8_t* buf, size_t len) {
+  if (!_h || !_h->fp) return 0;
+
+  if (_h->append) fseek(_h->fp, 0, SEEK_END);
+  long pos = ftell(_h->fp);
+  size_t n = fwrite(buf, 1, len, _h->fp);
+  if (n > 0 && _h->fs->_model_enabled) {
+    uint32_t bs = _h->fs->_cfg.block_size;
+    for (uint32_t b = pos / bs; b <= (pos + n - 1) / bs; b++) _h->dirty_blocks.insert(b);
+  }
+  _h->fs->_stats.bytes_written += n;
+  return n;
+}
+
+int File::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+size_t File::read(uint8_t* buf, size_t len) {
+  if (!_h || !_h->fp) return 0;
+
+  size_t n = fread(buf, 1, len, _h->fp);
+  _h->fs->_stats.bytes_read += n;
+  return n;
+}
+
+int File::peek() {
+  if (!_h || !_h->fp) return -1;
+
+  int c = fgetc(_h->fp);
+  if (c != EOF) ungetc(c, _h->fp);
+  return c == EOF ? -1 : c;
+}
+
+int File::available() {
+  if (!_h || !_h->fp) return 0;
+  return size() - position();
+}
+
+void File::commitDirty() {   // model a copy-on-write commit of each modified block
+  if (_h->dirty_blocks.empty()) return;
+
+  PosixFS* fs = _h->fs;
+  uint32_t bs = fs->_cfg.block_size;
+  size_t file_size = size();
+  for (auto b : _h->dirty_blocks) {
+    fs->chargeErase(_h->path, b);
+    size_t end = (b + 1) * (size_t) bs;
+    fs->chargePrograms(end <= file_size ? bs : (file_size > b * (size_t) bs ? file_size - b * (size_t) bs : 0));
+  }
+  _h->dirty_blocks.clear();
+  fs->chargeMetadata();   // file's size/CTZ list
+}
+
+void File::flush() {
+  if (!_h || !_h->fp) return;
+
+  fflush(_h->fp);
+  commitDirty();
+}
+
+bool File::seek(uint32_t pos) {
+  if (!_h || !_h->fp || pos > size()) return false;
+  return fseek(_h->fp, pos, SEEK_SET) == 0;
+}
+
+size_t File::position() const {
+  if (!_h || !_h->fp) return 0;
+  return ftell(_h->fp);
+}
+
+size_t File::size() const {
+  if (!_h || !_h->fp) return 0;
+
+  fflush(_h->fp);
+  struct stat st;
+  return fstat(fileno(_h->fp), &st) == 0 ? st.st_size : 0;
+}
+
+void File::close() {
+  if (_h) {
+    if (_h->fp) {
+      fflush(_h->fp);
+      commitDirty();
+    }
+    _h.reset();
+  }
+}
+
+const char* File::name() const {
+  if (!_h) return "";
+
+  size_t i = _h->path.rfind('/');
+  return i == std::string::npos ? _h->path.c_str() : _h->path.c_str() + i + 1;
+}
+
+bool File::isDirectory() const {
+  return _h && _h->dir != NULL;
+}
+
+File File::openNextFile() {
+  if (!_h || !_h->dir) return File();
+
+  struct dirent* e;
+  while ((e = readdir(_h->dir)) != NULL) {
+    if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) continue;
+
+    std::string child = _h->path;
+    if (child.empty() || child[child.size() - 1] != '/') child += "/";
+    child += e->d_name;
+    return _h->fs->open(child.c_str(), "r");
+  }
+  return File();  // no more
+}
+
+File::operator bool() const {
+  return _h && (_h->fp || _h->dir);
+}
+
+/* ------------------------------------ PosixFS -------------------------------------- */
+
+PosixFS::PosixFS(const char* root_dir) : _root(root_dir), _model_enabled(false) {
+  while (_root.size() > 1 && _root[_root.size() - 1] == '/') _root.erase(_root.size() - 1);
+  ::mkdir(_root.c_str(), 0755);
+  resetFlashStats();
+}
+
+std::string PosixFS::fullPath(const char* path) const {
+  if (path[0] == '/') return _root + path;
+  return _root + "/" + path;
+}
+
+void PosixFS::chargeErase(const std::string& path, uint32_t block) {
+  auto& counts = _wear[path];
+  if (counts.size() <= block) counts.resize(block + 1, 0);
+  counts[block]++;
+  if (counts[block] > _stats.max_block_erases) _stats.max_block_erases = counts[block];
+
+  _stats.block_erases++;
+  _stats.simulated_us += _cfg.block_erase_us;
+  if (_cfg.apply_delays) usleep(_cfg.block_erase_us);
+}
+
+void PosixFS::chargePrograms(uint32_t bytes) {
+  uint32_t pages = (bytes + _cfg.page_size - 1) / _cfg.page_size;
+  _stats.page_programs += pages;
+  _stats.simulated_us += (uint64_t) pages * _cfg.page_prog_us;
+  if (_cfg.apply_delays) usleep(pages * _cfg.page_prog_us);
+}
+
+void PosixFS::chargeMetadata() {
+  if (!_model_enabled) return;
+
+  chargeErase("/.metadata", 0);   // NOTE: doesn't model LittleFS's metadata pairs/compaction exactly
+  chargePrograms(_cfg.page_size);
+}
+
+File PosixFS::open(const char* path, const char* mode, bool create) {
+  std::string full = fullPath(path);
+  auto h = std::make_shared<File::Handle>(this, path);
+
+  if (isDir(full)) {
+    h->dir = opendir(full.c_str());
+    return h->dir ? File(h) : File();
+  }
+
+  const char* fmode;
+  if (strcmp(mode, "r") == 0) {
+    fmode = "rb";
+  } else if (strcmp(mode, "r+") == 0) {
+    fmode = "r+b";
+  } else if (strcmp(mode, "w") == 0) {
+    fmode = "wb";
+  } else if (strcmp(mode, "w+") == 0) {
+    fmode = "w+b";
+  } else if (strcmp(mode, "a") == 0 || strcmp(mode, "a+") == 0) {
+    fmode = "a+b";   // NOTE: allow reads, same as LittleFS
+    h->append = true;
+  } else {
+    return File();   // unsupported mode
+  }
+
+  bool is_new = access(full.c_str(), F_OK) != 0;
+  if (create && mode[0] != 'r') makeParentDirs(full);
+
+  h->fp = fopen(full.c_str(), fmode);
+  if (h->fp == NULL) return File();
+
+  if (is_new) chargeMetadata();
+  return File(h);
+}
+
+bool PosixFS::exists(const char* path) {
+  return access(fullPath(path).c_str(), F_OK) == 0;
+}
+
+bool PosixFS::remove(const char* path) {
+  if (::unlink(fullPath(path).c_str()) != 0) return false;
+
+  _wear.erase(path);   // NOTE: max_block_erases still records the worst wear
+  chargeMetadata();
+  return true;
+}
+
+bool PosixFS::rename(const char* path_from, const char* path_to) {
+  if (::rename(fullPath(path_from).c_str(), fullPath(path_to).c_str()) != 0) return false;
+
+  auto it = _wear.find(path_from);
+  if (it != _wear.end()) {   // data blocks don't move, just the directory entry
+    _wear[path_to] = it->second;
+    _wear.erase(path_from);
+  }
+  chargeMetadata();
+  return true;
+}
+
+bool PosixFS::mkdir(const char* path) {
+  if (::mkdir(fullPath(path).c_str(), 0755) != 0) return false;
+
+  chargeMetadata();
+  return true;
+}
+
+bool PosixFS::rmdir(const char* path) {
+  if (::rmdir(fullPath(path).c_str()) != 0) return false;
+
+  chargeMetadata();
+  return true;
+}
+
+static bool removeTree(const std::string& dir_path) {
+  DIR* dir = opendir(dir_path.c_str());
+  if (dir == NULL) return false;
+
+  bool success = true;
+  struct dirent* e;
+  while ((e = readdir(dir)) != NULL) {
+    if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) continue;
+
+    std::string child = dir_path + "/" + e->d_name;
+    if (isDir(child)) {
+      success = removeTree(child) && ::rmdir(child.c_str()) == 0 && success;
+    } else {
+      success = ::unlink(child.c_str()) == 0 && success;
+    }
+  }
+  closedir(dir);
+  return success;
+}
+
+bool PosixFS::format() {
+  _wear.clear();
+  return removeTree(_root);
+}
+
+void PosixFS::resetFlashStats() {
+  memset(&_stats, 0, sizeof(_stats));
+  _wear.clear();
+}
+
+uint32_t PosixFS::getBlockEraseCount(const char* path, uint32_t block) const {
+  auto it = _wear.find(path);
+  if (it == _wear.end() || block >= it->second.size()) return 0;
+  return it->second[block];
+}
+
+}
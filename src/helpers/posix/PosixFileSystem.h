@@ -0,0 +1,112 @@
+#pragma once
+
+#include <Stream.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+/*
+ * Host (Linux/macOS) FILESYSTEM, backed by a directory. Same API as the ESP32/RP2040 fs::FS, so code
+ * written for those platforms runs unchanged in host builds (define POSIX_PLATFORM).
+ *
+ * Optionally models the underlying NOR flash: each File's dirty blocks are committed (erase + page programs)
+ * on flush/close, copy-on-write style like LittleFS, with erase counts kept per (file, block).
+ */
+
+namespace posixfs {
+
+struct FlashModelConfig {
+  uint32_t page_size;        // program unit, bytes
+  uint32_t block_size;       // erase unit, bytes
+  uint32_t page_prog_us;     // latency of one page program
+  uint32_t block_erase_us;   // latency of one block erase
+  bool     apply_delays;     // actually sleep, otherwise just accumulate simulated_us
+
+  FlashModelConfig() {   // defaults approximate nRF52840 internal flash
+    page_size = 256;
+    block_size = 4096;
+    page_prog_us = 2600;     // 41us per 32-bit word
+    block_erase_us = 85000;
+    apply_delays = false;
+  }
+};
+
+struct FlashStats {
+  uint64_t bytes_read, bytes_written;
+  uint32_t page_programs, block_erases;
+  uint32_t max_block_erases;   // worst wear of any single block
+  uint64_t simulated_us;       // total modelled flash latency
+};
+
+class PosixFS;
+
+class File : public Stream {
+  struct Handle;
+  std::shared_ptr<Handle> _h;
+
+  friend class PosixFS;
+  File(std::shared_ptr<Handle> h) : _h(h) { }
+  void commitDirty();
+
+public:
+  File() { }
+
+  size_t write(uint8_t c);
+  size_t write(const uint8_t* buf, size_t len);
+  int read();
+  size_t read(uint8_t* buf, size_t len);
+  size_t readBytes(uint8_t* buf, size_t len) { return read(buf, len); }
+  int peek();
+  int available();
+  void flush();
+
+  bool seek(uint32_t pos);
+  size_t position() const;
+  size_t size() const;
+  void close();
+  const char* name() const;
+  bool isDirectory() const;
+  File openNextFile();
+  operator bool() const;
+};
+
+class PosixFS {
+  std::string _root;
+  bool _model_enabled;
+  FlashModelConfig _cfg;
+  FlashStats _stats;
+  std::map<std::string, std::vector<uint32_t> > _wear;   // erase counts, per block of each file
+
+  friend class File;
+  std::string fullPath(const char* path) const;
+  void chargeErase(const std::string& path, uint32_t block);
+  void chargePrograms(uint32_t bytes);
+  void chargeMetadata();
+
+public:
+  PosixFS(const char* root_dir);
+
+  File open(const char* path, const char* mode = "r", bool create = false);
+  bool exists(const char* path);
+  bool remove(const char* path);
+  bool rename(const char* path_from, const char* path_to);
+  bool mkdir(const char* path);
+  bool rmdir(const char* path);
+  bool format();   // remove everything under root dir
+
+  // flash model
+  void enableFlashModel(const FlashModelConfig& cfg) { _cfg = cfg; _model_enabled = true; }
+  void disableFlashModel() { _model_enabled = false; }
+  const FlashStats& getFlashStats() const { return _stats; }
+  void resetFlashStats();
+  uint32_t getBlockEraseCount(const char* path, uint32_t block) const;
+};
+
+}
+
+using posixfs::File;
+using posixfs::PosixFS;